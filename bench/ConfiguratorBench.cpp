@@ -0,0 +1,381 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+/**
+ * Microbenchmarks for the Configurator primitives - directory scan, cache
+ * stamps, file reads, JSON parsing & reply bookkeeping - each timed on its own
+ * so that a change to one of them can be measured in isolation.
+ *
+ *   configurator-microbench [--json <results file>] [scratch dir]...
+ *
+ * The filesystem benchmarks run once per scratch directory (by default
+ * /dev/shm & /var/tmp - tmpfs & a disk filesystem on most systems).
+ */
+
+#include "BusClient.h"
+#include "Configurator.h"
+
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+class BenchConfigurator : public Configurator
+{
+public:
+	BenchConfigurator(RunType type, BusClient& busClient, const std::string& configDirectory, bool cacheStatus)
+		: Configurator("", ConfigUnknown, type, busClient, configDirectory),
+		  m_cacheStatus(cacheStatus)
+	{
+	}
+
+	virtual const char* ConfiguratorName() const { return "BenchConfigurator"; }
+	virtual const char* ServiceName() const { return "com.palm.bench"; }
+
+protected:
+	virtual MojErr ProcessConfig(const std::string&, MojObject&) { return MojErrNone; }
+	virtual MojErr ProcessConfigRemoval(const std::string&, MojObject&) { return MojErrNone; }
+	virtual bool CanCacheConfiguratorStatus(const std::string&) const { return m_cacheStatus; }
+
+private:
+	bool m_cacheStatus;
+};
+
+struct Result {
+	std::string name;
+	std::string dir;
+	unsigned long iterations;
+	double nsPerOp;
+};
+
+std::vector<Result> s_results;
+
+gint64 now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (gint64)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void report(const std::string& name, const std::string& dir, unsigned long ops, gint64 elapsed)
+{
+	Result result;
+	result.name = name;
+	result.dir = dir;
+	result.iterations = ops;
+	result.nsPerOp = ops ? (double)elapsed / ops : 0;
+	s_results.push_back(result);
+
+	printf("%-40s %-12s %10lu ops %14.1f ns/op\n", name.c_str(), dir.c_str(), ops, result.nsPerOp);
+}
+
+void makeDirs(const std::string& path)
+{
+	for (size_t i = 1; i != std::string::npos; i = path.find('/', i + 1))
+		mkdir(path.substr(0, i).c_str(), 0755);
+	mkdir(path.c_str(), 0755);
+}
+
+void writeFile(const std::string& path, const std::string& contents)
+{
+	ofstream file(path.c_str(), ios::out | ios::trunc);
+	file << contents;
+}
+
+void removeTree(const std::string& path)
+{
+	std::string cmd = "rm -rf '" + path + "'";
+	if (system(cmd.c_str()) != 0)
+		fprintf(stderr, "failed to remove %s\n", path.c_str());
+}
+
+std::string kindJson(unsigned int indexes)
+{
+	ostringstream json;
+	json << "{\"id\":\"com.palm.bench.kind:1\",\"owner\":\"com.palm.bench\",\"indexes\":[";
+	for (unsigned int i = 0; i < indexes; i++) {
+		if (i)
+			json << ',';
+		json << "{\"name\":\"idx" << i << "\",\"props\":[{\"name\":\"field" << i << "\"},{\"name\":\"field" << i + 1 << "\"}]}";
+	}
+	json << "]}";
+	return json.str();
+}
+
+std::string activityJson()
+{
+	return "{\"activity\":{\"name\":\"com.palm.bench.sync\",\"description\":\"benchmark activity\","
+		"\"type\":{\"background\":true,\"persist\":true,\"explicit\":true},"
+		"\"schedule\":{\"interval\":\"1d\",\"precise\":false},"
+		"\"requirements\":{\"internet\":true},"
+		"\"callback\":{\"method\":\"palm://com.palm.bench/sync\",\"params\":{}}}}";
+}
+
+} // namespace
+
+class ConfiguratorBench
+{
+public:
+	ConfiguratorBench(BusClient& busClient) : m_busClient(busClient) {}
+
+	void Run(const std::string& scratch)
+	{
+		std::string dir = scratch + "/configurator-microbench";
+		removeTree(dir);
+		makeDirs(dir);
+
+		Configurator::SetRootDir(dir);
+		makeDirs(Configurator::ConfCacheDir());
+
+		ScanWide(dir, 5000);
+		ScanDeep(dir, 40, 25);
+		Stamps(dir, 2000);
+		Read(dir, "ReadFile/1KiB", 1024, 5000);
+		Read(dir, "ReadFile/1MiB", 1024 * 1024, 50);
+
+		removeTree(dir);
+	}
+
+	void Parse()
+	{
+		ParseJson("parse/kind-8-indexes", kindJson(8), 5000);
+		ParseJson("parse/kind-200-indexes", kindJson(200), 200);
+		ParseJson("parse/activity", activityJson(), 20000);
+	}
+
+	void Bookkeeping()
+	{
+		PendingReplies(100, false);
+		PendingReplies(100, true);
+		PendingReplies(1000, false);
+		PendingReplies(1000, true);
+		PendingReplies(10000, false);
+		PendingReplies(10000, true);
+	}
+
+private:
+	void Scan(const std::string& label, const std::string& dir, const std::string& configDir, unsigned int files)
+	{
+		const unsigned int rounds = 20;
+		Configurator::RunType types[] = { Configurator::Reconfigure, Configurator::Configure };
+		const char* names[] = { "/scan", "/scan+stamp-check" };
+
+		for (int t = 0; t < 2; t++) {
+			MojRefCountedPtr<BenchConfigurator> conf(new BenchConfigurator(types[t], m_busClient, configDir, true));
+			gint64 start = now();
+			for (unsigned int i = 0; i < rounds; i++) {
+				conf->m_configs.clear();
+				// every round scans the same files again
+				Configurator::ReleaseClaims(Configurator::Bulk);
+				std::vector<Configurator::FoundConfig> found;
+				conf->GetConfigFiles("", configDir, found);
+				conf->OrderConfigs(found);
+			}
+			report(label + names[t], dir, rounds * files, now() - start);
+		}
+	}
+
+	void ScanWide(const std::string& dir, unsigned int files)
+	{
+		std::string configDir = dir + "/wide";
+		makeDirs(configDir);
+		for (unsigned int i = 0; i < files; i++) {
+			ostringstream path;
+			path << configDir << "/com.palm.bench" << i;
+			writeFile(path.str(), "{}");
+		}
+		ostringstream label;
+		label << "GetConfigFiles/wide-" << files;
+		Scan(label.str(), dir, configDir, files);
+	}
+
+	void ScanDeep(const std::string& dir, unsigned int depth, unsigned int filesPerDir)
+	{
+		std::string configDir = dir + "/deep";
+		std::string level = configDir;
+		for (unsigned int d = 0; d < depth; d++) {
+			ostringstream name;
+			name << "/d" << d;
+			level += name.str();
+			makeDirs(level);
+			for (unsigned int f = 0; f < filesPerDir; f++) {
+				ostringstream path;
+				path << level << "/conf" << f;
+				writeFile(path.str(), "{}");
+			}
+		}
+		ostringstream label;
+		label << "GetConfigFiles/deep-" << depth << "x" << filesPerDir;
+		Scan(label.str(), dir, configDir, depth * filesPerDir);
+	}
+
+	void Stamps(const std::string& dir, unsigned int files)
+	{
+		std::string configDir = dir + "/stamps";
+		makeDirs(configDir);
+		std::vector<std::string> paths;
+		for (unsigned int i = 0; i < files; i++) {
+			ostringstream path;
+			path << configDir << "/com.palm.bench" << i;
+			writeFile(path.str(), "{}");
+			paths.push_back(path.str());
+		}
+
+		MojRefCountedPtr<BenchConfigurator> conf(new BenchConfigurator(Configurator::Configure, m_busClient, configDir, true));
+
+		gint64 start = now();
+		for (unsigned int i = 0; i < files; i++)
+			conf->IsAlreadyConfigured(paths[i]);
+		report("IsAlreadyConfigured/unstamped", dir, files, now() - start);
+
+		start = now();
+		for (unsigned int i = 0; i < files; i++)
+			conf->MarkConfigured(paths[i]);
+		report("MarkConfigured", dir, files, now() - start);
+
+		start = now();
+		for (unsigned int i = 0; i < files; i++)
+			conf->IsAlreadyConfigured(paths[i]);
+		report("IsAlreadyConfigured/stamped", dir, files, now() - start);
+
+		start = now();
+		for (unsigned int i = 0; i < files; i++)
+			conf->UnmarkConfigured(paths[i]);
+		report("UnmarkConfigured", dir, files, now() - start);
+	}
+
+	void Read(const std::string& dir, const std::string& label, size_t size, unsigned int rounds)
+	{
+		std::string path = dir + "/read";
+		writeFile(path, std::string(size, 'x'));
+
+		MojRefCountedPtr<BenchConfigurator> conf(new BenchConfigurator(Configurator::Configure, m_busClient, dir, true));
+		size_t total = 0;
+		gint64 start = now();
+		for (unsigned int i = 0; i < rounds; i++)
+			total += conf->ReadFile(path).size();
+		report(label, dir, rounds, now() - start);
+
+		if (total != size * rounds)
+			fprintf(stderr, "%s: short read (%zu of %zu bytes)\n", label.c_str(), total, size * rounds);
+	}
+
+	void ParseJson(const std::string& label, const std::string& json, unsigned int rounds)
+	{
+		gint64 start = now();
+		for (unsigned int i = 0; i < rounds; i++) {
+			MojObject parsed;
+			if (parsed.fromJson(json.c_str()) != MojErrNone) {
+				fprintf(stderr, "%s: failed to parse\n", label.c_str());
+				return;
+			}
+		}
+		report(label, "-", rounds, now() - start);
+	}
+
+	// replies removed from the pending list in the order the requests were sent,
+	// or the reverse (worst case for the linear search)
+	void PendingReplies(unsigned int pending, bool reverse)
+	{
+		MojRefCountedPtr<BenchConfigurator> conf(new BenchConfigurator(Configurator::Configure, m_busClient, "", false));
+		conf->m_state = Configurator::Done; // keeps Run() from completing through the BusClient
+
+		std::vector<std::string> configs;
+		for (unsigned int i = 0; i < pending; i++) {
+			ostringstream path;
+			path << "/etc/palm/db/kinds/com.palm.bench" << i;
+			configs.push_back(path.str());
+		}
+		for (unsigned int i = 0; i < pending; i++)
+			conf->m_pendingConfigs.push_back(PathTable::Intern(configs[i]));
+
+		MojObject response(MojObject::TypeObject);
+		response.putBool("returnValue", true);
+		bool cacheConfigured = false;
+
+		gint64 start = now();
+		for (unsigned int i = 0; i < pending; i++) {
+			const std::string& config = configs[reverse ? pending - 1 - i : i];
+			conf->BusResponseAsync(config, response, MojErrNone, 0, &cacheConfigured);
+		}
+		gint64 elapsed = now() - start;
+		Configurator::ResetConfigStats(Configurator::Bulk);
+
+		ostringstream label;
+		label << "BusResponseAsync/" << pending << (reverse ? "-reverse" : "-in-order");
+		report(label.str(), "-", pending, elapsed);
+	}
+
+	BusClient& m_busClient;
+};
+
+static void writeJson(const std::string& path)
+{
+	ofstream file(path.c_str(), ios::out | ios::trunc);
+	file << "[\n";
+	for (size_t i = 0; i < s_results.size(); i++) {
+		const Result& r = s_results[i];
+		file << "  {\"name\": \"" << r.name << "\", \"dir\": \"" << r.dir << "\", \"iterations\": "
+			 << r.iterations << ", \"ns_per_op\": " << r.nsPerOp << "}" << (i + 1 < s_results.size() ? "," : "") << "\n";
+	}
+	file << "]\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string jsonFile;
+	std::vector<std::string> dirs;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--json" && i + 1 < argc)
+			jsonFile = argv[++i];
+		else
+			dirs.push_back(arg);
+	}
+	if (dirs.empty()) {
+		dirs.push_back("/dev/shm");
+		dirs.push_back("/var/tmp");
+	}
+
+	BusClient busClient;
+	ConfiguratorBench bench(busClient);
+
+	for (size_t i = 0; i < dirs.size(); i++) {
+		if (access(dirs[i].c_str(), W_OK) != 0) {
+			fprintf(stderr, "skipping %s: %s\n", dirs[i].c_str(), strerror(errno));
+			continue;
+		}
+		bench.Run(dirs[i]);
+	}
+	bench.Parse();
+	bench.Bookkeeping();
+
+	if (!jsonFile.empty())
+		writeJson(jsonFile);
+	return 0;
+}
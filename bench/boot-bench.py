@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+# @@@LICENSE
+#
+#      Copyright (c) 2013 LG Electronics, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# LICENSE@@@
+
+"""
+End-to-end boot benchmark for the configurator.
+
+Generates synthetic device trees (system kinds with large index arrays, apps,
+services, permissions, activities & file cache types) and runs the configurator
+against them offline - "root=<tree> mock=<settings> packages" - in three
+scenarios:
+
+  first-boot   empty cache, everything is sent
+  warm-boot    every configuration already stamped
+  app-update   a slice of the apps gets new kinds & is rescanned
+
+For every scenario it records wall time, peak RSS (from wait4), the syscall
+count (strace -c -f on the first repeat, when strace is installed) and the bus
+messages the mock backend answered.  Results are written as JSON so that runs
+can be compared between commits:
+
+  boot-bench.py --configurator BUILD/configurator --apps 100,1000,10000 \\
+                --output results-$(git rev-parse --short HEAD).json
+  boot-bench.py --compare results-old.json results-new.json
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+SCENARIOS = ("first-boot", "warm-boot", "app-update")
+
+
+def write_json(path, obj):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        json.dump(obj, f, indent=1)
+
+
+def kind(kind_id, owner, indexes):
+    return {
+        "id": kind_id,
+        "owner": owner,
+        "indexes": [
+            {"name": "idx%d" % i,
+             "props": [{"name": "field%d" % i}, {"name": "field%d" % (i + 1)}]}
+            for i in range(indexes)
+        ],
+    }
+
+
+def permissions(kind_id, caller):
+    return [{"type": "db.kind", "object": kind_id, "caller": caller,
+             "operations": {"read": "allow", "create": "allow", "update": "allow", "delete": "allow"}}]
+
+
+def activity(name):
+    return {"activity": {"name": name, "description": "benchmark activity",
+                         "type": {"background": True},
+                         "schedule": {"interval": "1d"}}}
+
+
+def filecache_type(name):
+    return {"typeName": name, "loWatermark": 1000, "hiWatermark": 100000,
+            "size": 50000, "cost": 1, "lifetime": 86400}
+
+
+def package(root, pkg_dir, pkg_id, kinds, indexes, version=1):
+    conf = os.path.join(root, "usr/palm", pkg_dir, pkg_id, "configuration")
+    for k in range(kinds):
+        kind_id = "%s.kind%d:%d" % (pkg_id, k, version)
+        write_json(os.path.join(conf, "db/kinds", "%s.kind%d" % (pkg_id, k)), kind(kind_id, pkg_id, indexes))
+        write_json(os.path.join(conf, "db/permissions", "%s.kind%d" % (pkg_id, k)), permissions(kind_id, pkg_id))
+    write_json(os.path.join(conf, "activities", pkg_id, "sync"), activity(pkg_id + ".sync"))
+    write_json(os.path.join(conf, "filecache_types", pkg_id), filecache_type(pkg_id))
+
+
+def mark_first_use_done(root):
+    """Creates the first use flags - activities are held back until they exist."""
+    prefs = os.path.join(root, "var/luna/preferences")
+    os.makedirs(prefs, exist_ok=True)
+    for flag in ("ran-first-use", "first-use-profile-created"):
+        open(os.path.join(prefs, flag), "w").close()
+
+
+def generate(root, args):
+    """Lays out a device tree under root."""
+    mark_first_use_done(root)
+    etc = os.path.join(root, "etc/palm")
+    for s in range(args.system_kinds):
+        owner = "com.palm.system%d" % s
+        kind_id = "%s.kind:1" % owner
+        write_json(os.path.join(etc, "db/kinds", owner), kind(kind_id, owner, args.system_indexes))
+        write_json(os.path.join(etc, "db/permissions", owner), permissions(kind_id, owner))
+        write_json(os.path.join(etc, "activities", owner, "periodic"), activity(owner + ".periodic"))
+        write_json(os.path.join(etc, "filecache_types", owner), filecache_type(owner))
+
+    for a in range(args.app_count):
+        package(root, "applications", "com.bench.app%05d" % a, args.app_kinds, args.app_indexes)
+    for s in range(args.services):
+        package(root, "services", "com.bench.service%03d" % s, args.app_kinds, args.app_indexes)
+
+
+def update_apps(root, args):
+    """Rewrites a slice of the apps with new kind versions, returns their ids."""
+    count = max(1, args.app_count * args.update_percent // 100)
+    step = max(1, args.app_count // count)
+    ids = ["com.bench.app%05d" % a for a in range(0, args.app_count, step)][:count]
+    for app_id in ids:
+        package(root, "applications", app_id, args.app_kinds, args.app_indexes + 1, version=2)
+    return ids
+
+
+def clear_cache(root):
+    """Drops everything the configurator wrote (stamps, registries) under root."""
+    for entry in os.listdir(root):
+        path = os.path.join(root, entry)
+        if entry not in ("etc", "usr") and os.path.isdir(path):
+            shutil.rmtree(path, ignore_errors=True)
+    mark_first_use_done(root)
+
+
+def run_configurator(args, root, extra, use_strace):
+    report = os.path.join(root, "mock-report.json")
+    settings = os.path.join(root, "mock-settings.json")
+    mock = {"latency": args.latency, "jitter": args.jitter, "report": report}
+    write_json(settings, mock)
+
+    cmd = [args.configurator, "root=" + root, "mock=" + settings, "packages"] + extra
+    strace_out = None
+    if use_strace:
+        strace_out = os.path.join(root, "strace.txt")
+        cmd = ["strace", "-c", "-f", "-o", strace_out] + cmd
+
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+
+    result = {
+        "wall_s": round(wall, 4),
+        "user_s": round(usage.ru_utime, 4),
+        "sys_s": round(usage.ru_stime, 4),
+        "peak_rss_kb": usage.ru_maxrss,
+        "exit_status": os.waitstatus_to_exitcode(status),
+    }
+
+    if strace_out and os.path.exists(strace_out):
+        result["syscalls"] = parse_strace(strace_out)
+        os.unlink(strace_out)
+
+    if os.path.exists(report):
+        with open(report) as f:
+            summary = json.load(f)
+        result["bus_messages"] = summary.get("messages", 0)
+        result["bus_methods"] = summary.get("methods", {})
+        os.unlink(report)
+    return result
+
+
+def parse_strace(path):
+    """Total call count from the summary line of strace -c."""
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if fields and fields[-1] == "total":
+                # % time, seconds, usecs/call, calls, [errors], total
+                return int(fields[3])
+    return None
+
+
+def bench(args):
+    results = {
+        "commit": subprocess.run(["git", "rev-parse", "--short", "HEAD"], capture_output=True, text=True,
+                                 cwd=os.path.dirname(os.path.abspath(__file__))).stdout.strip(),
+        "parameters": {k: v for k, v in vars(args).items() if k not in ("compare", "output")},
+        "runs": [],
+    }
+
+    for apps in args.apps:
+        args.app_count = apps
+        root = tempfile.mkdtemp(prefix="configurator-bench-", dir=args.workdir)
+        try:
+            generate(root, args)
+            for scenario in SCENARIOS:
+                extra = []
+                if scenario == "app-update":
+                    extra = ["rescan=" + app_id for app_id in update_apps(root, args)]
+                for repeat in range(args.repeat):
+                    if scenario == "first-boot" and repeat > 0:
+                        clear_cache(root)
+                    # strace inflates the times - only the first repeat is traced
+                    # & compare() picks the fastest repeat
+                    use_strace = args.strace and repeat == 0 and shutil.which("strace") is not None
+                    run = run_configurator(args, root, extra, use_strace)
+                    run.update({"apps": apps, "scenario": scenario, "repeat": repeat})
+                    results["runs"].append(run)
+                    print("%6d apps  %-10s  #%d  %8.3fs  rss %7d kB  syscalls %-8s  bus %s" % (
+                        apps, scenario, repeat, run["wall_s"], run["peak_rss_kb"],
+                        run.get("syscalls", "-"), run.get("bus_messages", "-")))
+        finally:
+            if not args.keep:
+                shutil.rmtree(root, ignore_errors=True)
+
+    write_json(os.path.abspath(args.output), results)
+    print("results written to %s" % args.output)
+
+
+def best(runs):
+    """Fastest repeat per (apps, scenario) - the least noisy number to compare."""
+    table = {}
+    syscalls = {}
+    for run in runs:
+        key = (run["apps"], run["scenario"])
+        if "syscalls" in run:
+            syscalls[key] = run["syscalls"]
+        if key not in table or run["wall_s"] < table[key]["wall_s"]:
+            table[key] = dict(run)
+    for key, count in syscalls.items():
+        table[key]["syscalls"] = count
+    return table
+
+
+def compare(old_path, new_path, threshold):
+    with open(old_path) as f:
+        old = json.load(f)
+    with open(new_path) as f:
+        new = json.load(f)
+
+    old_runs, new_runs = best(old["runs"]), best(new["runs"])
+    regressions = 0
+    print("%-24s %-6s %12s %12s %8s" % ("scenario", "apps", old.get("commit", "old"), new.get("commit", "new"), "change"))
+    for key in sorted(set(old_runs) & set(new_runs)):
+        for metric in ("wall_s", "peak_rss_kb", "syscalls", "bus_messages"):
+            a, b = old_runs[key].get(metric), new_runs[key].get(metric)
+            if not a or b is None:
+                continue
+            change = (b - a) * 100.0 / a
+            flag = ""
+            if change > threshold:
+                flag = "  REGRESSION"
+                regressions += 1
+            print("%-24s %-6d %12s %12s %+7.1f%%%s" % ("%s %s" % (key[1], metric), key[0], a, b, change, flag))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--configurator", help="configurator binary to benchmark")
+    parser.add_argument("--apps", default="100,1000",
+                        type=lambda s: [int(n) for n in s.split(",")], help="comma separated app counts")
+    parser.add_argument("--services", type=int, default=20)
+    parser.add_argument("--app-kinds", type=int, default=2, help="kinds per app")
+    parser.add_argument("--app-indexes", type=int, default=4, help="indexes per app kind")
+    parser.add_argument("--system-kinds", type=int, default=200)
+    parser.add_argument("--system-indexes", type=int, default=40, help="indexes per system kind")
+    parser.add_argument("--update-percent", type=int, default=5, help="apps updated in app-update")
+    parser.add_argument("--latency", type=int, default=1, help="mock reply latency (ms)")
+    parser.add_argument("--jitter", type=int, default=0, help="mock reply jitter (ms)")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--no-strace", dest="strace", action="store_false",
+                        help="skip the syscall count (strace slows the run down)")
+    parser.add_argument("--workdir", default=None, help="where trees are generated")
+    parser.add_argument("--keep", action="store_true", help="keep the generated trees")
+    parser.add_argument("--output", default="boot-bench.json")
+    parser.add_argument("--compare", nargs=2, metavar=("OLD", "NEW"), help="compare two result files")
+    parser.add_argument("--threshold", type=float, default=10.0, help="regression threshold in %% for --compare")
+    args = parser.parse_args()
+
+    if args.compare:
+        return compare(args.compare[0], args.compare[1], args.threshold)
+    if not args.configurator:
+        parser.error("--configurator is required")
+    args.configurator = os.path.abspath(args.configurator)
+    bench(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
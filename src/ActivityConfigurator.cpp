@@ -37,13 +37,12 @@ const char* const ActivityConfigurator::ACTIVITY_NAME		  = "activityName";
 const char* const ActivityConfigurator::FIRST_USE_SAFE		  = "firstUseSafe";
 const char* const ActivityConfigurator::APP_DIR		  = "/etc/palm/activities/applications/";
 const char* const ActivityConfigurator::SERVICE_DIR		  = "/etc/palm/activities/services/";
-const char* const ActivityConfigurator::FIRST_USE_FLAG    = "/var/luna/preferences/ran-first-use";
-const char* const ActivityConfigurator::FIRST_USE_PROFILE_FLAG = "/var/luna/preferences/first-use-profile-created";
 
 class ActivityConfigureResponse : public ConfiguratorCallback {
 public:
 	ActivityConfigureResponse(ActivityConfigurator *conf, const string& path)
-		: ConfiguratorCallback(conf, path)
+		: ConfiguratorCallback(conf, path),
+		  m_activityConfigurator(conf)
 	{
 	}
 
@@ -75,8 +74,17 @@ public:
 				LOG_WARNING(MSGID_ACTIVITY_CONFIGURATOR_WARNING, 0, "errorCode not provided in request failure");
 			}
 		}
+
+		// held back for first use & created now - by the queue or by a walk
+		response.get("returnValue", success);
+		if (!err && success && m_activityConfigurator->m_currentType != Configurator::RemoveConfiguration)
+			m_activityConfigurator->m_busClient.FirstUse().Registered(m_config);
+
 		return DelegateResponse(response, err);
 	}
+
+private:
+	ActivityConfigurator* m_activityConfigurator;
 };
 
 const char* ActivityConfigurator::ConfiguratorName() const
@@ -96,22 +104,10 @@ ConfiguratorCallback* ActivityConfigurator::CreateCallback(const std::string &fi
 
 ActivityConfigurator::ActivityConfigurator(const std::string& id, ConfigType confType, RunType type, BusClient& busClient, string configDirectory)
 	: Configurator(id, confType, type, busClient, configDirectory),
-	  m_firstUseOnly(true)
+	  m_firstUseOnly(!busClient.FirstUse().Completed())
 {
-	int err;
-	struct stat buf;
-	err = stat(FIRST_USE_FLAG, &buf);
-	if (err == 0) {
-		err = stat(FIRST_USE_PROFILE_FLAG, &buf);
-		if (err == 0) {
-			LOG_DEBUG("Fist Use has completed, installing all Activities");
-			m_firstUseOnly = false;
-		}
-	}
-#ifdef WEBOS_TARGET_MACHINE_STANDALONE
-	//Set the m_firstUseOnly flag to false as there is no first use run in Desktop.
- 	m_firstUseOnly = false;
-#endif
+	if (!m_firstUseOnly)
+		LOG_DEBUG("Fist Use has completed, installing all Activities");
 }
 
 ActivityConfigurator::~ActivityConfigurator()
@@ -151,6 +147,9 @@ MojErr ActivityConfigurator::ProcessConfig(const string& filePath, MojObject& pa
 		bool firstUseSafe;
 		if (!params.get(FIRST_USE_SAFE, firstUseSafe) || !firstUseSafe) {
 			LOG_DEBUG("Running before first use but activity %s not marked as safe for configuration at this time", filePath.c_str());
+			// registered from the queue once first use is over
+			HoldBack(true);
+			m_busClient.FirstUse().Add(m_id, ConfigDir(), m_confType, filePath);
 			return MojErrInProgress;
 		}
 	}
@@ -203,7 +202,7 @@ MojErr ActivityConfigurator::ProcessConfig(const string& filePath, MojObject& pa
 	// so that the schema on activity manager isn't violated
 	RemoveKey(params, FIRST_USE_SAFE);
 
-	return m_busClient.CreateRequest()->send(CreateCallback(filePath)->m_slot, ServiceName(), ACTIVITYMGR_CREATE_METHOD, params);
+	return SendRequest(CreateCallback(filePath), ACTIVITYMGR_CREATE_METHOD, params);
 }
 
 MojErr ActivityConfigurator::ProcessConfigRemoval(const string& filePath, MojObject& params)
@@ -230,5 +229,5 @@ MojErr ActivityConfigurator::ProcessConfigRemoval(const string& filePath, MojObj
 	// {"activityName": "...", "creator": "..."}
 	err = request.putString(CREATOR, creator.c_str()); MojErrCheck(err);
 
-	return m_busClient.CreateRequest()->send(CreateCallback(filePath)->m_slot, ServiceName(), ACTIVITYMGR_REMOVE_METHOD, request);
+	return SendRequest(CreateCallback(filePath), ACTIVITYMGR_REMOVE_METHOD, request);
 }
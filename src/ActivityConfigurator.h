@@ -49,8 +49,6 @@ private:
 	static const char* const FIRST_USE_SAFE;
 	static const char* const APP_DIR;
 	static const char* const SERVICE_DIR;
-	static const char* const FIRST_USE_FLAG;
-	static const char* const FIRST_USE_PROFILE_FLAG;
 
 	bool m_firstUseOnly;
 
@@ -32,14 +32,26 @@
 */
 
 #include "BusClient.h"
+#include "CallbackPool.h"
+#include "PathTable.h"
+#include "ResultLedger.h"
 #include "db/MojDbServiceDefs.h"
 #include "core/MojServiceMessage.h"
 #include "ActivityConfigurator.h"
 #include "DbKindConfigurator.h"
 #include "DbPermissionsConfigurator.h"
+#include "EventRing.h"
 #include "FileCacheConfigurator.h"
+#include "MockServiceBackend.h"
 
 #include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fstream>
 
 using namespace std;
 
@@ -61,18 +73,71 @@ const char* const BusClient::BASE_PALM_OFFSET            = "usr/palm/";
 const char* const BusClient::APPS_DIR                    = "applications/";
 const char* const BusClient::SERVICES_DIR                = "services/";
 const char* const BusClient::CONF_SUBDIR                 = "/configuration/";
-
-int main(int argc, char** argv)
-{
-	BusClient app;
-	return app.main(argc, argv);
-}
+const char* const BusClient::SETTINGS_FILE               = "/etc/palm/configurator.json";
+const char* const BusClient::BUS_SERVICE                 = "com.palm.bus";
+const char* const BusClient::SERVER_STATUS_METHOD        = "signal/registerServerStatus";
+const char* const BusClient::MOCK_ARG                    = "mock";
+const char* const BusClient::ROOT_ARG                    = "root=";
+const char* const BusClient::PACKAGES_ARG                = "packages";
+const char* const BusClient::RESCAN_ARG                  = "rescan=";
+const char* const BusClient::TRACE_ARG                   = "trace=";
+const char* const BusClient::EVENTS_FILE                 = "events.log";
+const char* const BusClient::OWNER_REPORT_FILE           = "owner-costs.json";
+const unsigned int BusClient::DEFERRED_KIND_INTERVAL     = 500; // ms between deferred kind updates
+const unsigned int BusClient::BULK_SHARE                 = 4;   // rounds per bulk round while interactive work is sent
+const unsigned int BusClient::DEFAULT_TICK_BUDGET        = 2000; // us of configurator work per main loop tick
 
 static inline bool startsWith(const char *str, const std::string& prefix)
 {
 	return 0 == strncmp(str, prefix.c_str(), prefix.length());
 }
 
+class BusClient::ServiceStatusWatcher : public ReplyHandler
+{
+public:
+	ServiceStatusWatcher(BusClient& client, const std::string& serviceName)
+		: m_client(client),
+		  m_serviceName(serviceName)
+	{
+	}
+
+	static gboolean WaitExpiredCallback(gpointer data)
+	{
+		ServiceStatusWatcher* watcher = static_cast<MojRefCountedPtr<ServiceStatusWatcher>*>(data)->get();
+		watcher->m_client.ServiceWaitExpired(watcher->m_serviceName);
+		return false;
+	}
+
+	static void ReleaseCallback(gpointer data)
+	{
+		delete static_cast<MojRefCountedPtr<ServiceStatusWatcher>*>(data);
+	}
+
+private:
+	MojErr HandleReply(MojObject& response, MojErr err)
+	{
+		bool connected = false;
+		bool success = true;
+		response.get("returnValue", success);
+
+		// {"serviceName": "...", "connected": true|false} on every change
+		if (err || !success || !response.get("connected", connected)) {
+			LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 2,
+					PMLOGKS("service", m_serviceName.c_str()),
+					PMLOGKFV("error", "%d", err),
+					"Server status of %s unavailable - not waiting for it", m_serviceName.c_str());
+			Cancel();
+			connected = true;
+		}
+
+		m_client.ServiceStatusChanged(m_serviceName, connected);
+		return MojErrNone;
+	}
+
+	BusClient& m_client;
+	const std::string m_serviceName;
+};
+
 BusClient::BusMethods::BusMethods(BusClient& client)
 : m_client(client)
 {
@@ -93,6 +158,26 @@ BusClient::BusMethods::BusMethods(BusClient& client)
 	err = addMethod("unconfigure", (Callback) &BusMethods::Unconfigure);
 	if (err)
 		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register unconfigure method: %i", err);
+
+	err = addMethod("configureFiles", (Callback) &BusMethods::ConfigureFiles);
+	if (err)
+		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register configureFiles method: %i", err);
+
+	err = addMethod("firstUseComplete", (Callback) &BusMethods::FirstUseComplete);
+	if (err)
+		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register firstUseComplete method: %i", err);
+
+	err = addMethod("stats", (Callback) &BusMethods::Stats);
+	if (err)
+		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register stats method: %i", err);
+
+	err = addMethod("owners", (Callback) &BusMethods::Owners);
+	if (err)
+		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register owners method: %i", err);
+
+	err = addMethod("isConfigured", (Callback) &BusMethods::IsConfigured);
+	if (err)
+		LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 0, "failed to register isConfigured method: %i", err);
 }
 
 static MojErr getTypes(MojObject typesArray, BusClient::ScanTypes &bitmask)
@@ -126,6 +211,52 @@ static MojErr getTypes(MojObject typesArray, BusClient::ScanTypes &bitmask)
 	return MojErrNone;
 }
 
+static MojErr getDbTargets(MojObject dbsArray, BusClient::DbTargets &bitmask)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	MojObject::ConstArrayIterator it = dbsArray.arrayBegin();
+	if (it == NULL)
+		MojErrThrowMsg(MojErrInvalidMsg, "'dbs' not an array");
+
+	for (MojObject::ConstArrayIterator ni = dbsArray.arrayEnd(); it != ni; it++) {
+		MojString db;
+		MojErr err = it->stringValue(db);
+		MojErrCheck(err);
+
+		if (db == "main")
+			bitmask |= BusClient::MAINDB;
+		else if (db == "media")
+			bitmask |= BusClient::MEDIADB;
+		else if (db == "temp")
+			bitmask |= BusClient::TEMPDB;
+		else
+			MojErrThrowMsg(MojErrInvalidMsg, "unrecognized db '%s'", db.data());
+	}
+
+	return MojErrNone;
+}
+
+// the per-file results of the run - see ResultLedger
+static MojErr putLedger(MojObject& response, const ResultLedger& ledger)
+{
+	MojObject records(MojObject::TypeArray);
+	MojErr err = ledger.ToJson(records);
+	MojErrCheck(err);
+	err = response.put("ledger", records);
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+// requests of scan & unconfigure are arrays - any entry can set the
+// options of the call ("ledger", "subscribe")
+static bool requestFlag(const MojObject& request, const char* key)
+{
+	bool set = false;
+	request.get(key, set);
+	return set;
+}
+
 //->Start of API documentation comment block
 /**
 @page com_palm_configurator com.palm.configurator
@@ -138,14 +269,22 @@ This method will scan all folders and run all configuration files.
 Name | Required | Type | Description
 -----|----------|------|------------
 types | yes  | Array | List of different configuration types. Types are dbkinds, filecache, activities.
+ledger | no | Boolean | Include the per-file results in the reply.
+subscribe | no | Boolean | Stream progress updates until the final reply.
 
 @par Returns(Call)
 Name | Required | Type | Description
 -----|----------|------|------------
 returnValue | yes | Boolean | True
+ledger | no | Array | One {path, type, status, errorCode, latencyMs} object per config file, if requested.
 
 @par Returns(Subscription)
-None
+Name | Required | Type | Description
+-----|----------|------|------------
+event | yes | String | 'files', 'configurator' or 'app'.
+files | no | Array | Ledger records of the files handled since the last update ('files').
+configurator | no | String | Configurator that has finished ('configurator').
+id | no | String | Application or service id ('configurator', 'app' - all of its configurators are done).
 
 @}
 */
@@ -155,7 +294,7 @@ MojErr BusClient::BusMethods::Run(MojServiceMessage* msg, MojObject& payload)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (WorkEnqueued((Callback) &BusMethods::Run, msg, payload))
+	if (WorkEnqueued(Configurator::Bulk, (Callback) &BusMethods::Run, msg, payload))
 		return MojErrNone;
 
 	try {
@@ -167,7 +306,13 @@ MojErr BusClient::BusMethods::Run(MojServiceMessage* msg, MojObject& payload)
 		err = getTypes(types, bitmask);
 		MojErrCheck(err);
 
-		m_client.m_msg.reset(msg);
+		BusClient::Lane& lane = m_client.RequestLane();
+		lane.msg.reset(msg);
+		lane.replyLedger = requestFlag(payload, "ledger");
+		if (requestFlag(payload, "subscribe")) {
+			err = lane.progress.Start(msg, Configurator::Ledger(m_client.m_priority));
+			MojErrCheck(err);
+		}
 		m_client.Run(bitmask);
 
 		m_client.RunNextConfigurator();
@@ -181,19 +326,226 @@ MojErr BusClient::BusMethods::Run(MojServiceMessage* msg, MojObject& payload)
 	return MojErrNone;
 }
 
-bool BusClient::BusMethods::WorkEnqueued(Callback callback, MojServiceMessage *msg, MojObject &payload)
+//->Start of API documentation comment block
+/**
+@page com_palm_configurator com.palm.configurator
+@{
+@section com_palm_configurator_firstusecomplete firstUseComplete
+
+Registers the activities that were held back because first use hadn't
+completed yet (activities not marked firstUseSafe).  Called by the upstart job
+on the first use events.  Each activity leaves the queue once it is created.
+
+@par Parameters
+None
+
+@par Returns(Call)
+Name | Required | Type | Description
+-----|----------|------|------------
+returnValue | yes | Boolean | True - false (errorCode MojErrInProgress) if first use is still running
+configured | yes | Integer | Number of activities registered
+
+@}
+*/
+//->End of API documentation comment block
+
+MojErr BusClient::BusMethods::FirstUseComplete(MojServiceMessage* msg, MojObject& payload)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	if (WorkEnqueued(Configurator::Bulk, (Callback) &BusMethods::FirstUseComplete, msg, payload))
+		return MojErrNone;
+
+	if (!m_client.m_firstUse.Recheck())
+		MojErrThrowMsg(MojErrInProgress, "first use hasn't completed");
+
+	m_client.RequestLane().msg.reset(msg);
+	m_client.ReleaseFirstUseQueue();
+	m_client.RunNextConfigurator();
+
+	return MojErrNone;
+}
+
+//->Start of API documentation comment block
+/**
+@page com_palm_configurator com.palm.configurator
+@{
+@section com_palm_configurator_stats stats
+
+Counters & latency histograms of this process, for profiling the configurator.
+
+@par Parameters
+None
+
+@par Returns(Call)
+Name | Required | Type | Description
+-----|----------|------|------------
+returnValue | yes | Boolean | True
+uptimeMs | yes | Integer | Time since the service started
+repliesPerSecond | yes | Integer | Replies to configurator calls per second of uptime
+configurators | yes | Object | Per configurator {scanned, skipped, duplicates, sent, succeeded, failed, inFlight, retried, deferred}
+services | yes | Object | The same counters per target service
+methods | yes | Object | Per method called {count, meanMs, maxMs, buckets} - buckets counts the replies by latency ("<1", "<2", "<4" ... ">=65536" ms), empty ones left out
+queues | yes | Object | {configurators, interactiveConfigurators, pendingCalls, deferredKinds} still waiting
+callbacks | yes | Object | Callback pool {allocations, reused, oversized, live, peak, slabs, slabBytes, resets}
+paths | yes | Object | Path table {paths, directories, names, stringBytes, lookups}
+configured | yes | Integer | Config files that succeeded in the current runs
+failed | yes | Integer | Config files that failed in the current runs
+deferred | yes | Integer | Config files deferred in the current runs
+
+@}
+*/
+//->End of API documentation comment block
+
+// answered straight away - never queued behind a running scan
+MojErr BusClient::BusMethods::Stats(MojServiceMessage* msg, MojObject& payload)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	MojObject stats(MojObject::TypeObject);
+	MojErr err = m_client.StatsToJson(stats);
+	MojErrCheck(err);
+
+	err = msg->replySuccess(stats);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+//->Start of API documentation comment block
+/**
+@page com_palm_configurator com.palm.configurator
+@{
+@section com_palm_configurator_owners owners
+
+The applications & services whose configurations cost the most in this
+process, and the report saved for the current boot.
+
+@par Parameters
+Name | Required | Type | Description
+-----|----------|------|------------
+count | no | Integer | Number of owners to return, 10 by default
+sortBy | no | String | 'latency' (default), 'bytes', 'parse' or 'requests'
+
+@par Returns(Call)
+Name | Required | Type | Description
+-----|----------|------|------------
+returnValue | yes | Boolean | True
+owners | yes | Array | One {owner, bytesRead, parseUs, requests, latencyMs} object per owner, heaviest first
+report | no | Object | Report saved when the service last exited - {bootId, owners} with the 100 owners of highest latency over all runs of that boot
+
+@}
+*/
+//->End of API documentation comment block
+
+MojErr BusClient::BusMethods::Owners(MojServiceMessage* msg, MojObject& payload)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	MojInt64 count = 10;
+	payload.get("count", count);
+	if (count <= 0)
+		MojErrThrowMsg(MojErrInvalidArg, "'count' must be positive");
+
+	OwnerCosts::SortKey key = OwnerCosts::ByLatency;
+	MojString sortBy;
+	bool found = false;
+	MojErr err = payload.get("sortBy", sortBy, found);
+	MojErrCheck(err);
+	if (found && !OwnerCosts::ParseSortKey(sortBy.data(), key))
+		MojErrThrowMsg(MojErrInvalidArg, "unknown sortBy '%s'", sortBy.data());
+
+	MojObject owners(MojObject::TypeArray);
+	err = m_client.m_ownerCosts.Top(count, key, owners);
+	MojErrCheck(err);
+
+	MojObject response(MojObject::TypeObject);
+	err = response.put("owners", owners);
+	MojErrCheck(err);
+
+	MojObject report;
+	if (OwnerCosts::Load(Configurator::ConfCacheDir() + OWNER_REPORT_FILE, report) == MojErrNone) {
+		err = response.put("report", report);
+		MojErrCheck(err);
+	}
+
+	err = msg->replySuccess(response);
+	MojErrCheck(err);
+
+	return MojErrNone;
+}
+
+//->Start of API documentation comment block
+/**
+@page com_palm_configurator com.palm.configurator
+@{
+@section com_palm_configurator_isconfigured isConfigured
+
+Whether all configurations of an application or service have been applied.
+
+@par Parameters
+Name | Required | Type | Description
+-----|----------|------|------------
+id | yes  | String | Application or Service Id
+subscribe | no | Boolean | If not configured yet, reply again once it is.
+
+@par Returns(Call)
+Name | Required | Type | Description
+-----|----------|------|------------
+returnValue | yes | Boolean | True
+id | yes | String | Application or Service Id
+configured | yes | Boolean | All of its kinds, permissions, file cache types & activities succeeded.
+
+@par Returns(Subscription)
+Name | Required | Type | Description
+-----|----------|------|------------
+id | yes | String | Application or Service Id
+configured | yes | Boolean | True
+
+@}
+*/
+//->End of API documentation comment block
+
+// a lookup in the owner stamps - fine to answer in the middle of a run
+MojErr BusClient::BusMethods::IsConfigured(MojServiceMessage* msg, MojObject& payload)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	MojString id;
+	MojErr err = payload.getRequired("id", id);
+	MojErrCheck(err);
+
+	std::string owner(id.data(), id.length());
+	bool configured = m_client.m_readiness.IsConfigured(owner);
+
+	MojObject response(MojObject::TypeObject);
+	err = response.putString("id", id); MojErrCheck(err);
+	err = response.putBool("configured", configured); MojErrCheck(err);
+	err = msg->replySuccess(response);
+	MojErrCheck(err);
+
+	if (!configured && requestFlag(payload, "subscribe"))
+		m_client.m_readiness.Watch(owner, msg);
+
+	return MojErrNone;
+}
+
+bool BusClient::BusMethods::WorkEnqueued(Configurator::Priority priority, Callback callback, MojServiceMessage *msg, MojObject &payload)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (m_client.m_msg.get() == NULL)
+	BusClient::Lane& lane = m_client.m_lanes[priority];
+	if (lane.msg.get() == NULL) {
+		m_client.m_priority = priority;
 		return false;
+	}
 
 	BusClient::PendingWork pending;
 	pending.instance = this;
 	pending.callback = callback;
 	pending.msg.reset(msg);
 	pending.payload = payload;
-	m_client.m_pending.push_back(pending);
+	lane.pending.push_back(pending);
 	return true;
 }
 
@@ -212,14 +564,24 @@ Name | Required | Type | Description
 id | yes  | String | Application Id
 type | yes | String | Either 'app' or 'service'
 location | yes | String | Indicates if it is a system app or a third party app.
+types | no | Array | Configuration types to scan - dbkinds, dbpermissions, filecache, activities (default all).
+dbs | no | Array | db8 instances for dbkinds & dbpermissions - main, media, temp (default all).
+ledger | no | Boolean | Include the per-file results in the reply.
+subscribe | no | Boolean | Stream progress updates until the final reply.
 
 @par Returns(Call)
 Name | Required | Type | Description
 -----|----------|------|------------
 returnValue | yes | Boolean | True
+ledger | no | Array | One {path, type, status, errorCode, latencyMs} object per config file, if requested.
 
 @par Returns(Subscription)
-None
+Name | Required | Type | Description
+-----|----------|------|------------
+event | yes | String | 'files', 'configurator' or 'app'.
+files | no | Array | Ledger records of the files handled since the last update ('files').
+configurator | no | String | Configurator that has finished ('configurator').
+id | no | String | Application or service id ('configurator', 'app' - all of its configurators are done).
 
 @}
 */
@@ -229,7 +591,7 @@ MojErr BusClient::BusMethods::Rescan(MojServiceMessage* msg, MojObject& payload)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (WorkEnqueued((Callback) &BusMethods::Rescan, msg, payload))
+	if (WorkEnqueued(Configurator::Interactive, (Callback) &BusMethods::Rescan, msg, payload))
 		return MojErrNone;
 
 	return ScanRequest(msg, payload, BusClient::ForceRescan);
@@ -249,14 +611,24 @@ Name | Required | Type | Description
 id | yes  | String | Application Id
 type | yes | String | Either 'app' or 'service'
 location | yes | String | Indicates if it is a system app or a third party app.
+types | no | Array | Configuration types to scan - dbkinds, dbpermissions, filecache, activities (default all).
+dbs | no | Array | db8 instances for dbkinds & dbpermissions - main, media, temp (default all).
+ledger | no | Boolean | Include the per-file results in the reply.
+subscribe | no | Boolean | Stream progress updates until the final reply.
 
 @par Returns(Call)
 Name | Required | Type | Description
 -----|----------|------|------------
 returnValue | yes | Boolean | True
+ledger | no | Array | One {path, type, status, errorCode, latencyMs} object per config file, if requested.
 
 @par Returns(Subscription)
-None
+Name | Required | Type | Description
+-----|----------|------|------------
+event | yes | String | 'files', 'configurator' or 'app'.
+files | no | Array | Ledger records of the files handled since the last update ('files').
+configurator | no | String | Configurator that has finished ('configurator').
+id | no | String | Application or service id ('configurator', 'app' - all of its configurators are done).
 
 @}
 */
@@ -266,7 +638,7 @@ MojErr BusClient::BusMethods::Scan(MojServiceMessage* msg, MojObject& payload)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (WorkEnqueued((Callback) &BusMethods::Scan, msg, payload))
+	if (WorkEnqueued(Configurator::Interactive, (Callback) &BusMethods::Scan, msg, payload))
 		return MojErrNone;
 
 	return ScanRequest(msg, payload, BusClient::LazyScan);
@@ -282,44 +654,78 @@ MojErr BusClient::BusMethods::ScanRequest(MojServiceMessage* msg, MojObject& pay
 			MojErrThrowMsg(MojErrInternal, "invalid message format");
 		}
 
-		m_client.m_msg.reset(msg);
+		// every entry is checked before the first one is scanned - an invalid
+		// one must not leave the others running with the error already sent
+		ScanEntryCollection entries;
 
+		bool ledger = false;
+		bool subscribe = false;
 		for (MojObject::ConstArrayIterator it = payload.arrayBegin(); it != payload.arrayEnd(); it++) {
 			const MojObject& request = *it;
 			MojString locationStr;
 			MojString typeStr;
-			MojString app;
-			BusClient::PackageType type;
-			BusClient::PackageLocation location;
+			MojObject typesArray;
+			MojObject dbsArray;
+			ScanEntry entry;
 
-			err = request.getRequired("id", app);
+			err = request.getRequired("id", entry.app);
 			MojErrCheck(err);
 
 			err = request.getRequired("type", typeStr);
 			MojErrCheck(err);
 
+			if (requestFlag(request, "ledger"))
+				ledger = true;
+			if (requestFlag(request, "subscribe"))
+				subscribe = true;
+
+			// an update that only touched some types scans just those
+			if (!request.get("types", typesArray)) {
+				entry.types = BusClient::ALL_TYPES;
+			} else {
+				err = getTypes(typesArray, entry.types);
+				MojErrCheck(err);
+			}
+
+			if (!request.get("dbs", dbsArray)) {
+				entry.dbs = BusClient::ALL_DBS;
+			} else {
+				err = getDbTargets(dbsArray, entry.dbs);
+				MojErrCheck(err);
+			}
+
 			err = request.getRequired("location", locationStr);
 			MojErrCheck(err);
 
 			if (typeStr == "app") {
-				type = BusClient::Application;
+				entry.type = BusClient::Application;
 			} else if (typeStr == "service") {
-				type = BusClient::Service;
+				entry.type = BusClient::Service;
 			} else {
 				MojErrThrow(MojErrInvalidMsg);
 			}
 
 			if (locationStr == "system") {
-				location = BusClient::System;
+				entry.location = BusClient::System;
 			} else if (locationStr == "third party") {
-				location = BusClient::ThirdParty;
+				entry.location = BusClient::ThirdParty;
 			} else {
 				MojErrThrow(MojErrInvalidMsg);
 			}
 
-			m_client.Scan(confmode, app, type, location);
+			entries.push_back(entry);
 		}
 
+		BusClient::Lane& lane = m_client.RequestLane();
+		lane.msg.reset(msg);
+		lane.replyLedger = ledger;
+		for (ScanEntryCollection::const_iterator i = entries.begin(); i != entries.end(); ++i)
+			m_client.Scan(confmode, i->app, i->type, i->location, i->types, i->dbs);
+
+		if (subscribe) {
+			err = lane.progress.Start(msg, Configurator::Ledger(m_client.m_priority));
+			MojErrCheck(err);
+		}
 		m_client.RunNextConfigurator();
 	} catch (const std::exception& e) {
 		MojErrThrowMsg(MojErrInternal, "%s", e.what());
@@ -344,14 +750,22 @@ Name | Required | Type | Description
 id | yes  | String | Application or Service Id
 type | yes | String | Either 'app' or 'service'
 location | yes | String | Indicates if it is a system or a third party app.
+ledger | no | Boolean | Include the per-file results in the reply.
+subscribe | no | Boolean | Stream progress updates until the final reply.
 
 @par Returns(Call)
 Name | Required | Type | Description
 -----|----------|------|------------
 returnValue | yes | Boolean | True
+ledger | no | Array | One {path, type, status, errorCode, latencyMs} object per config file, if requested.
 
 @par Returns(Subscription)
-None
+Name | Required | Type | Description
+-----|----------|------|------------
+event | yes | String | 'files', 'configurator' or 'app'.
+files | no | Array | Ledger records of the files handled since the last update ('files').
+configurator | no | String | Configurator that has finished ('configurator').
+id | no | String | Application or service id ('configurator', 'app' - all of its configurators are done).
 
 @}
 */
@@ -361,7 +775,7 @@ MojErr BusClient::BusMethods::Unconfigure(MojServiceMessage *msg, MojObject &pay
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (WorkEnqueued((Callback) &BusMethods::Unconfigure, msg, payload))
+	if (WorkEnqueued(Configurator::Interactive, (Callback) &BusMethods::Unconfigure, msg, payload))
 		return MojErrNone;
 
 	try {
@@ -370,8 +784,10 @@ MojErr BusClient::BusMethods::Unconfigure(MojServiceMessage *msg, MojObject &pay
 			MojErrThrowMsg(MojErrInternal, "invalid message format");
 		}
 
-		m_client.m_msg.reset(msg);
+		BusClient::Lane& lane = m_client.RequestLane();
+		lane.msg.reset(msg);
 
+		bool subscribe = false;
 		for (MojObject::ConstArrayIterator it = payload.arrayBegin(); it != payload.arrayEnd(); it++) {
 			const MojObject& request = *it;
 			MojString locationStr;
@@ -388,6 +804,11 @@ MojErr BusClient::BusMethods::Unconfigure(MojServiceMessage *msg, MojObject &pay
 			err = request.getRequired("type", typeStr);
 			MojErrCheck(err);
 
+			if (requestFlag(request, "ledger"))
+				lane.replyLedger = true;
+			if (requestFlag(request, "subscribe"))
+				subscribe = true;
+
 			if (!request.get("types", typesArray)) {
 				types = BusClient::ACTIVITIES | BusClient::FILECACHE | BusClient::DBKINDS | BusClient::DBPERMISSIONS;
 			} else {
@@ -417,6 +838,10 @@ MojErr BusClient::BusMethods::Unconfigure(MojServiceMessage *msg, MojObject &pay
 			m_client.Unconfigure(app, type, location, types);
 		}
 
+		if (subscribe) {
+			err = lane.progress.Start(msg, Configurator::Ledger(m_client.m_priority));
+			MojErrCheck(err);
+		}
 		m_client.RunNextConfigurator();
 
 	} catch (const std::exception& e) {
@@ -428,61 +853,256 @@ MojErr BusClient::BusMethods::Unconfigure(MojServiceMessage *msg, MojObject &pay
 	return MojErrNone;
 }
 
-BusClient::BusClient()
-: m_dbClient(&m_service),
-  m_mediaDbClient(&m_service, MojDbServiceDefs::MediaServiceName),
-  m_tempDbClient(&m_service, MojDbServiceDefs::TempServiceName),
-  m_configuratorsCompleted(0),
-  m_launchedAsService(false),
-  m_shuttingDown(false),
-  m_wrongAplication(false),
-  m_timerTimeout(0)
-{
-}
+//->Start of API documentation comment block
+/**
+@page com_palm_configurator com.palm.configurator
+@{
+@section com_palm_configurator_configurefiles configureFiles
 
-BusClient::~BusClient()
-{
-}
+Configure (or remove) just the listed configuration files - e.g. the ones an
+installer has just unpacked.  Nothing else is scanned & the files are sent
+whether or not they have been configured before.  Every path has to resolve
+(symlinks & '..' included) to a regular file inside one of the configuration
+directories - a file to remove may be gone already, its directory may not.
+A path listed more than once is configured once.
 
-MojDbClient& BusClient::GetDbClient()
-{
-	return m_dbClient;
-}
+@par Parameters
+Name | Required | Type | Description
+-----|----------|------|------------
+files | yes | Array | {path, operation} objects - operation is 'configure' (default) or 'remove'.
+id | no | String | Application or service id the files belong to - without it they are system configurations under /etc/palm.
+type | no | String | Either 'app' or 'service' (required with id).
+location | no | String | Indicates if it is a system or a third party app (required with id).
+ledger | no | Boolean | Include the per-file results in the reply.
+subscribe | no | Boolean | Stream progress updates until the final reply.
 
-MojRefCountedPtr<MojServiceRequest> BusClient::CreateRequest()
-{
-	MojRefCountedPtr<MojServiceRequest> req;
-	m_service.createRequest(req);
-	return req;
-}
+@par Returns(Call)
+Name | Required | Type | Description
+-----|----------|------|------------
+returnValue | yes | Boolean | True
+ledger | no | Array | One {path, type, status, errorCode, latencyMs} object per config file, if requested.
 
-MojRefCountedPtr<MojServiceRequest> BusClient::CreateRequest(const char *forgedAppId)
-{
-	MojRefCountedPtr<MojServiceRequest> req;
-	m_service.createRequest(req, false, forgedAppId);
-	return req;
-}
+@par Returns(Subscription)
+Name | Required | Type | Description
+-----|----------|------|------------
+event | yes | String | 'files', 'configurator' or 'app'.
+files | no | Array | Ledger records of the files handled since the last update ('files').
+configurator | no | String | Configurator that has finished ('configurator').
+id | no | String | Application or service id ('configurator', 'app' - all of its configurators are done).
 
-MojErr BusClient::open()
+@}
+*/
+//->End of API documentation comment block
+
+MojErr BusClient::BusMethods::ConfigureFiles(MojServiceMessage* msg, MojObject& payload)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	// set up luna-service
+	if (WorkEnqueued(Configurator::Interactive, (Callback) &BusMethods::ConfigureFiles, msg, payload))
+		return MojErrNone;
+
+	try {
+		MojErr err;
+		MojObject files;
+		err = payload.getRequired("files", files);
+		MojErrCheck(err);
+		if (files.type() != MojObject::TypeArray || files.empty())
+			MojErrThrowMsg(MojErrInvalidArg, "'files' must be a non-empty array");
+
+		ListedConfigCollection configs;
+		for (MojObject::ConstArrayIterator it = files.arrayBegin(); it != files.arrayEnd(); it++) {
+			MojString path;
+			MojString operation;
+			bool found = false;
+
+			err = it->getRequired("path", path);
+			MojErrCheck(err);
+			err = it->get("operation", operation, found);
+			MojErrCheck(err);
+
+			ListedConfig config;
+			config.path = m_client.m_rootDir + path.data();
+			config.typeDir = NULL;
+			if (!found || operation == "configure")
+				config.runType = Configurator::Reconfigure;
+			else if (operation == "remove")
+				config.runType = Configurator::RemoveConfiguration;
+			else
+				MojErrThrowMsg(MojErrInvalidArg, "unrecognized operation '%s'", operation.data());
+			configs.push_back(config);
+		}
+
+		MojString app;
+		bool found = false;
+		err = payload.get("id", app, found);
+		MojErrCheck(err);
+
+		std::string baseDir = m_client.m_rootDir + ROOT_BASE_DIR;
+		Configurator::ConfigType configType = Configurator::ConfigUnknown;
+		bool appExists = true;
+		if (found) {
+			MojString typeStr;
+			MojString locationStr;
+			BusClient::PackageType type;
+			BusClient::PackageLocation location;
+
+			err = payload.getRequired("type", typeStr);
+			MojErrCheck(err);
+			err = payload.getRequired("location", locationStr);
+			MojErrCheck(err);
+
+			if (typeStr == "app") {
+				type = BusClient::Application;
+			} else if (typeStr == "service") {
+				type = BusClient::Service;
+			} else {
+				MojErrThrow(MojErrInvalidMsg);
+			}
+
+			if (locationStr == "system") {
+				location = BusClient::System;
+			} else if (locationStr == "third party") {
+				location = BusClient::ThirdParty;
+			} else {
+				MojErrThrow(MojErrInvalidMsg);
+			}
+
+			baseDir = m_client.appConfDir(app, type, location, appExists);
+			configType = PackageTypeToConfigType(type);
+		}
+
+		BusClient::Lane& lane = m_client.RequestLane();
+		std::map<std::string, Configurator::RunType> listed;
+		for (ListedConfigCollection::iterator i = configs.begin(); i != configs.end(); ) {
+			i->typeDir = m_client.TypeDir(baseDir, i->path, i->runType != Configurator::RemoveConfiguration);
+			if (i->typeDir == NULL) {
+				MojErrThrowMsg(MojErrInvalidArg, "'%s' is not a file in a configuration directory of '%s'", i->path.c_str(), baseDir.c_str());
+			}
+
+			std::pair<std::map<std::string, Configurator::RunType>::iterator, bool> first =
+					listed.insert(std::make_pair(i->path, i->runType));
+			if (first.second) {
+				++i;
+			} else if (first.first->second == i->runType) {
+				i = configs.erase(i);
+			} else {
+				MojErrThrowMsg(MojErrInvalidArg, "'%s' is listed to be configured & removed", i->path.c_str());
+			}
+		}
+
+		lane.msg.reset(msg);
+		if (!appExists)
+			lane.wrongApplication = true;
+		lane.replyLedger = requestFlag(payload, "ledger");
+		if (requestFlag(payload, "subscribe")) {
+			err = lane.progress.Start(msg, Configurator::Ledger(m_client.m_priority));
+			MojErrCheck(err);
+		}
+		m_client.ConfigureFiles(app, baseDir, configType, configs);
+
+		m_client.RunNextConfigurator();
+
+	} catch (const std::exception& e) {
+		MojErrThrowMsg(MojErrInternal, "%s", e.what());
+	} catch(...) {
+		MojErrThrowMsg(MojErrInternal, "uncaught exception");
+	}
+
+	return MojErrNone;
+}
+
+BusClient::BusClient()
+: m_backend(NULL),
+  m_mocked(false),
+  m_dbClient(&m_service),
+  m_mediaDbClient(&m_service, MojDbServiceDefs::MediaServiceName),
+  m_tempDbClient(&m_service, MojDbServiceDefs::TempServiceName),
+  m_priority(Configurator::Bulk),
+  m_bulkTicks(0),
+  m_workSource(0),
+  m_workRequested(false),
+  m_tickBudget(DEFAULT_TICK_BUDGET),
+  m_launchedAsService(false),
+  m_shuttingDown(false),
+  m_timerTimeout(0),
+  m_deferredKindInFlight(false),
+  m_deferredKindTimeout(0),
+  m_statsSignal(0),
+  m_scanPackages(false)
+{
+	m_defaultPolicy.timeout = 30000;
+	m_defaultPolicy.retries = 2;
+	m_defaultPolicy.backoff = 1000;
+	m_defaultPolicy.breakerThreshold = 3;
+	m_defaultPolicy.probeInterval = 5000;
+	m_defaultPolicy.readyTimeout = 30000;
+}
+
+BusClient::~BusClient()
+{
+	if (!m_ownerCosts.Empty())
+		m_ownerCosts.Save(Configurator::ConfCacheDir() + OWNER_REPORT_FILE);
+
+	if (m_statsSignal != 0)
+		g_source_remove(m_statsSignal);
+	delete m_backend;
+}
+
+MojDbClient& BusClient::GetDbClient()
+{
+	return m_dbClient;
+}
+
+MojErr BusClient::Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies)
+{
+	return m_backend->Send(handler, service, method, payload, forgedAppId, numReplies);
+}
+
+MojErr BusClient::open()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	// set up luna-service
 
 	MojErr err = Base::open();
 	MojErrCheck(err);
 
-	err = m_service.open(SERVICE_NAME);
-	MojErrCheck(err);
+	if (!m_mocked) {
+		err = m_service.open(SERVICE_NAME);
+		MojErrCheck(err);
 
-	err = m_service.attach(m_reactor.impl());
-	MojErrCheck(err);
+		err = m_service.attach(m_reactor.impl());
+		MojErrCheck(err);
+
+		m_backend = new LunaServiceBackend(m_service);
+		MojAllocCheck(m_backend);
+	} else if (m_launchedAsService) {
+		MojErrThrowMsg(MojErrNotImplemented, "%s cannot be combined with service mode", MOCK_ARG);
+	}
+
+	LoadSettings();
+	m_firstUse.Load(m_rootDir);
+
+	m_statsSignal = g_unix_signal_add(SIGUSR1, &BusClient::DumpStatsCallback, this);
 
 	// If we're not launched as a service, then we're launching at boot,
 	// which means we should run all the configurators.
 	if (!m_launchedAsService) {
 		LOG_DEBUG("Not run as dynamic service - run startup configurations");
 		Run(DBKINDS | DBPERMISSIONS | FILECACHE | ACTIVITIES);
+
+		if (m_scanPackages) {
+			ScanPackages(Application);
+			ScanPackages(Service);
+		}
+
+		for (std::vector<std::string>::const_iterator i = m_rescanIds.begin(); i != m_rescanIds.end(); ++i) {
+			MojString appId;
+			err = appId.assign(i->c_str());
+			MojErrCheck(err);
+			Scan(ForceRescan, appId, Application, System);
+		}
+
 		RunNextConfigurator();
 	} else {
 		LOG_DEBUG("launched as service");
@@ -492,6 +1112,7 @@ MojErr BusClient::open()
 
 		err = m_service.addCategory(MojLunaService::DefaultCategory, m_methods.get());
 	}
+
 	LOG_DEBUG("bus client %p", this);
 
 	return MojErrNone;
@@ -505,20 +1126,363 @@ MojErr BusClient::handleArgs(const StringVec& args)
 	if (args.size() && args[0] == "service")
 		m_launchedAsService = true;
 
+	// Offline runs (benchmarks, tests against a copy of a device tree):
+	//   mock | mock=<settings file>  stand-in for the services instead of the bus
+	//   root=<dir>                   prefix for every configuration & cache path
+	//   packages                     also scan all installed apps & services
+	//   rescan=<app id>              also force a rescan of an app (an update)
+	//   trace=<file>                 write a Chrome trace of the run to file
+	for (MojSize i = 0; i < args.size(); ++i) {
+		std::string arg = args[i].data();
+
+		if (arg.compare(0, strlen(ROOT_ARG), ROOT_ARG) == 0) {
+			m_rootDir = arg.substr(strlen(ROOT_ARG));
+			if (!m_rootDir.empty() && m_rootDir[m_rootDir.size() - 1] == '/')
+				m_rootDir.erase(m_rootDir.size() - 1);
+			Configurator::SetRootDir(m_rootDir);
+		} else if (arg == PACKAGES_ARG) {
+			m_scanPackages = true;
+		} else if (arg.compare(0, strlen(RESCAN_ARG), RESCAN_ARG) == 0) {
+			m_rescanIds.push_back(arg.substr(strlen(RESCAN_ARG)));
+		} else if (arg.compare(0, strlen(TRACE_ARG), TRACE_ARG) == 0) {
+			m_tracer.Enable(arg.substr(strlen(TRACE_ARG)));
+		} else if (arg == MOCK_ARG || arg.compare(0, strlen(MOCK_ARG) + 1, std::string(MOCK_ARG) + "=") == 0) {
+			MockServiceBackend* mock = new MockServiceBackend;
+			MojAllocCheck(mock);
+			delete m_backend;
+			m_backend = mock;
+			m_mocked = true;
+
+			if (arg != MOCK_ARG) {
+				err = mock->Load(arg.substr(strlen(MOCK_ARG) + 1));
+				MojErrCheck(err);
+			}
+		}
+	}
+
 	return MojErrNone;
 }
 
+static void readPolicy(const MojObject& settings, BusClient::ServicePolicy& policy)
+{
+	MojInt64 value;
+
+	if (settings.get("timeout", value) && value > 0)
+		policy.timeout = value;
+	if (settings.get("retries", value) && value >= 0)
+		policy.retries = value;
+	if (settings.get("retryBackoff", value) && value > 0)
+		policy.backoff = value;
+	if (settings.get("breakerThreshold", value) && value > 0)
+		policy.breakerThreshold = value;
+	if (settings.get("probeInterval", value) && value > 0)
+		policy.probeInterval = value;
+	if (settings.get("readyTimeout", value) && value >= 0)
+		policy.readyTimeout = value;
+}
+
+void BusClient::LoadSettings()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	std::string settingsFile = m_rootDir + SETTINGS_FILE;
+	ifstream file(settingsFile.c_str());
+	if (!file.good()) {
+		LOG_DEBUG("No %s - using default settings", settingsFile.c_str());
+		return;
+	}
+
+	std::string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	MojObject settings;
+	if (settings.fromJson(json.c_str()) != MojErrNone) {
+		LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 1,
+				PMLOGKS("file", settingsFile.c_str()),
+				"Failed to parse %s - using default settings", settingsFile.c_str());
+		return;
+	}
+
+	readPolicy(settings, m_defaultPolicy);
+
+	// {"tickBudget": <ms>} - 0 advances each configurator once per tick
+	MojInt64 tickBudget;
+	if (settings.get("tickBudget", tickBudget) && tickBudget >= 0)
+		m_tickBudget = tickBudget * 1000;
+
+	// {"trace": "<file>"} traces runs of the service as well
+	MojString traceFile;
+	bool found = false;
+	if (!m_tracer.Enabled() && settings.get("trace", traceFile, found) == MojErrNone && found)
+		m_tracer.Enable(traceFile.data());
+
+	MojObject services;
+	if (settings.get("services", services)) {
+		for (MojObject::ConstIterator i = services.begin(); i != services.end(); ++i) {
+			ServicePolicy policy = m_defaultPolicy;
+			readPolicy(i.value(), policy);
+			m_policies[i.key().data()] = policy;
+		}
+	}
+}
+
+const BusClient::ServicePolicy& BusClient::Policy(const std::string& serviceName) const
+{
+	ServicePolicyMap::const_iterator i = m_policies.find(serviceName);
+	if (i == m_policies.end())
+		return m_defaultPolicy;
+	return i->second;
+}
+
+bool BusClient::AllowRequest(const std::string& serviceName)
+{
+	ServiceBreaker& breaker = m_breakers[serviceName];
+
+	switch (breaker.state) {
+	case ServiceBreaker::Closed:
+		return true;
+	case ServiceBreaker::HalfOpen:
+		// a probe is already in flight
+		return false;
+	case ServiceBreaker::Open:
+		break;
+	}
+
+	if (g_get_monotonic_time() - breaker.openedAt < (gint64)Policy(serviceName).probeInterval * 1000)
+		return false;
+
+	LOG_DEBUG("Probing %s", serviceName.c_str());
+	breaker.state = ServiceBreaker::HalfOpen;
+	return true;
+}
+
+void BusClient::RecordResult(const std::string& serviceName, bool unavailable)
+{
+	ServiceBreaker& breaker = m_breakers[serviceName];
+
+	if (!unavailable) {
+		bool wasOpen = breaker.state != ServiceBreaker::Closed;
+		breaker.state = ServiceBreaker::Closed;
+		breaker.failures = 0;
+		if (breaker.probeTimer != 0) {
+			g_source_remove(breaker.probeTimer);
+			breaker.probeTimer = 0;
+		}
+		if (wasOpen) {
+			LOG_DEBUG("%s is back - closing breaker", serviceName.c_str());
+			ReleaseDeferredSends(serviceName);
+		}
+		return;
+	}
+
+	breaker.failures++;
+	if (breaker.state == ServiceBreaker::HalfOpen || breaker.failures >= Policy(serviceName).breakerThreshold) {
+		if (breaker.state == ServiceBreaker::Closed) {
+			LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 2,
+					PMLOGKS("service", serviceName.c_str()),
+					PMLOGKFV("failures", "%u", breaker.failures),
+					"%s unavailable after %u attempts - deferring its remaining configurations", serviceName.c_str(), breaker.failures);
+		}
+		breaker.state = ServiceBreaker::Open;
+		breaker.openedAt = g_get_monotonic_time();
+		ArmProbe(serviceName, breaker);
+	}
+}
+
+void BusClient::DeferSend(Configurator* configurator, const std::string& serviceName, const std::string& filePath)
+{
+	DeferredSend deferred;
+	deferred.configurator.reset(configurator);
+	deferred.filePath = filePath;
+	m_deferredSends[serviceName].push_back(deferred);
+}
+
+void BusClient::ArmProbe(const std::string& serviceName, ServiceBreaker& breaker)
+{
+	if (breaker.probeTimer != 0)
+		return;
+
+	BreakerProbe* probe = new BreakerProbe;
+	probe->client = this;
+	probe->serviceName = serviceName;
+	breaker.probeTimer = g_timeout_add_full(G_PRIORITY_DEFAULT, Policy(serviceName).probeInterval,
+			&BusClient::ProbeCallback, probe, &BusClient::ProbeReleased);
+}
+
+gboolean BusClient::ProbeCallback(gpointer data)
+{
+	BreakerProbe* probe = static_cast<BreakerProbe*>(data);
+	probe->client->m_breakers[probe->serviceName].probeTimer = 0;
+	probe->client->Probe(probe->serviceName);
+	return false;
+}
+
+void BusClient::ProbeReleased(gpointer data)
+{
+	delete static_cast<BreakerProbe*>(data);
+}
+
+// sends the first of the deferred configs that makes it to the bus - its
+// reply closes the breaker (& sends the rest) or opens it for another interval
+void BusClient::Probe(const std::string& serviceName)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	ServiceBreaker& breaker = m_breakers[serviceName];
+	DeferredSendQueue& queue = m_deferredSends[serviceName];
+
+	// a send that fails right away re-arms the timer - wait for that one
+	while (breaker.state == ServiceBreaker::Open && breaker.probeTimer == 0 && !queue.empty()) {
+		DeferredSend deferred = queue.front();
+		queue.pop_front();
+
+		// the interval is up - let AllowRequest turn this one into the probe
+		breaker.openedAt = 0;
+		deferred.configurator->SendDeferred(deferred.filePath);
+	}
+}
+
+void BusClient::ReleaseDeferredSends(const std::string& serviceName)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	DeferredSendMap::iterator i = m_deferredSends.find(serviceName);
+	if (i == m_deferredSends.end())
+		return;
+
+	DeferredSendQueue released;
+	released.swap(i->second);
+	m_deferredSends.erase(i);
+
+	LOG_DEBUG("Sending %zu deferred configurations to %s", released.size(), serviceName.c_str());
+	for (DeferredSendQueue::iterator d = released.begin(); d != released.end(); ++d)
+		d->configurator->SendDeferred(d->filePath);
+}
+
+// what is left is picked up by the next run
+void BusClient::DropDeferredSends()
+{
+	for (ServiceBreakerMap::iterator i = m_breakers.begin(); i != m_breakers.end(); ++i) {
+		if (i->second.probeTimer != 0) {
+			g_source_remove(i->second.probeTimer);
+			i->second.probeTimer = 0;
+		}
+	}
+	m_deferredSends.clear();
+}
+
+bool BusClient::ServiceConnected(const std::string& serviceName) const
+{
+	ServiceStatusMap::const_iterator i = m_serviceStatus.find(serviceName);
+	return i == m_serviceStatus.end() || i->second.connected;
+}
+
+bool BusClient::ServiceReady(const std::string& serviceName)
+{
+	ServiceStatusMap::iterator i = m_serviceStatus.find(serviceName);
+	if (i == m_serviceStatus.end()) {
+		i = m_serviceStatus.insert(ServiceStatusMap::value_type(serviceName, ServiceStatus())).first;
+		WatchService(serviceName, i->second);
+	}
+	return i->second.connected || i->second.gaveUp;
+}
+
+void BusClient::WatchService(const std::string& serviceName, ServiceStatus& status)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	status.watcher.reset(new ServiceStatusWatcher(*this, serviceName));
+
+	MojObject payload(MojObject::TypeObject);
+	MojErr err = payload.putString("serviceName", serviceName.c_str());
+	if (err == MojErrNone)
+		err = Send(status.watcher.get(), BUS_SERVICE, SERVER_STATUS_METHOD, payload, NULL, MojServiceRequest::Unlimited);
+
+	if (err) {
+		LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 2,
+				PMLOGKS("service", serviceName.c_str()),
+				PMLOGKFV("error", "%d", err),
+				"Failed to watch server status of %s - not waiting for it", serviceName.c_str());
+		status.connected = true;
+		return;
+	}
+
+	ArmReadyTimeout(serviceName, status);
+}
+
+// configurations for the service are held until it is up - or until
+// readyTimeout has passed
+void BusClient::ArmReadyTimeout(const std::string& serviceName, ServiceStatus& status)
+{
+	if (status.timer != 0 || status.watcher.get() == NULL)
+		return;
+
+	status.timer = g_timeout_add_full(G_PRIORITY_DEFAULT, Policy(serviceName).readyTimeout,
+			&ServiceStatusWatcher::WaitExpiredCallback, new MojRefCountedPtr<ServiceStatusWatcher>(status.watcher),
+			&ServiceStatusWatcher::ReleaseCallback);
+}
+
+void BusClient::ServiceStatusChanged(const std::string& serviceName, bool connected)
+{
+	ServiceStatus& status = m_serviceStatus[serviceName];
+	status.connected = connected;
+
+	if (!connected) {
+		LOG_DEBUG("%s is not up - holding its configurations", serviceName.c_str());
+		// it went away after having been up - wait for it again, but not forever
+		status.gaveUp = false;
+		ArmReadyTimeout(serviceName, status);
+		return;
+	}
+
+	LOG_DEBUG("%s is up - releasing its configurations", serviceName.c_str());
+	if (status.timer != 0) {
+		g_source_remove(status.timer);
+		status.timer = 0;
+	}
+
+	// no need to wait for a probe to find out
+	ServiceBreakerMap::iterator breaker = m_breakers.find(serviceName);
+	if (breaker != m_breakers.end() && breaker->second.state != ServiceBreaker::Closed)
+		RecordResult(serviceName, false);
+
+	RunNextConfigurator();
+}
+
+void BusClient::ServiceWaitExpired(const std::string& serviceName)
+{
+	ServiceStatus& status = m_serviceStatus[serviceName];
+	status.timer = 0;
+	status.gaveUp = true;
+
+	LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 1,
+			PMLOGKS("service", serviceName.c_str()),
+			"%s did not come up in time - sending its configurations anyway", serviceName.c_str());
+	RunNextConfigurator();
+}
+
 std::string BusClient::appConfDir(const MojString& appId, PackageType type, PackageLocation location)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	bool exists = true;
+	std::string confPath = appConfDir(appId, type, location, exists);
+	if (!exists) {
+		RequestLane().wrongApplication = true;
+	}
+
+	return confPath;
+}
+
+std::string BusClient::appConfDir(const MojString& appId, PackageType type, PackageLocation location, bool& exists) const
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 	std::string confPath;
 
 	switch (location) {
 	case System:
-		confPath = "/";
+		confPath = m_rootDir + BASE_ROOT;
 		break;
 	case ThirdParty:
-		confPath = BASE_CRYPTOFS;
+		confPath = m_rootDir + BASE_CRYPTOFS;
 		break;
 	}
 
@@ -533,9 +1497,7 @@ std::string BusClient::appConfDir(const MojString& appId, PackageType type, Pack
 		break;
 	}
 	confPath.append(appId.begin(), appId.end());
-	if (access(confPath.c_str(), R_OK) != 0) {
-		m_wrongAplication = true;
-	}
+	exists = (access(confPath.c_str(), R_OK) == 0);
 
 	return confPath + CONF_SUBDIR;
 }
@@ -543,21 +1505,16 @@ std::string BusClient::appConfDir(const MojString& appId, PackageType type, Pack
 void BusClient::Run(ScanTypes bitmask)
 {
 	MojString id;
-	ScanDir(id, Configurator::Configure, ROOT_BASE_DIR, bitmask, Configurator::ConfigUnknown, DeprecatedDbKind);
+	ScanDir(id, Configurator::Configure, m_rootDir + ROOT_BASE_DIR, bitmask, Configurator::ConfigUnknown, DeprecatedDbKind);
 }
 
-void BusClient::ScanDir(const MojString& _id, Configurator::RunType scanType, const std::string &baseDir, ScanTypes bitmask, Configurator::ConfigType configType, AdditionalFileTypes types)
+void BusClient::ScanDir(const MojString& _id, Configurator::RunType scanType, const std::string &baseDir, ScanTypes bitmask, Configurator::ConfigType configType, AdditionalFileTypes types, DbTargets dbs)
 {
 	const std::string id(_id.data(), _id.length());
+	ConfiguratorCollection& configurators = RequestLane().configurators;
+	size_t first = configurators.size();
 
-	if (m_shuttingDown) {
-		LOG_DEBUG("Aborting shutdown - request received");
-		assert(m_timerTimeout != 0);
-		g_source_remove(m_timerTimeout);
-		m_timerTimeout = 0;
-		assert(m_shuttingDown);
-		m_shuttingDown = false;
-	}
+	CancelShutdown();
 
 	if (bitmask & DBKINDS) {
 		if (types & DeprecatedDbKind) {
@@ -565,44 +1522,152 @@ void BusClient::ScanDir(const MojString& _id, Configurator::RunType scanType, co
 			LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 1,
 					PMLOGKS("directory", baseDir.c_str()),
 					"Scanning deprecated mojodb config directory under %s", baseDir.c_str());
-			ConfiguratorPtr oldDbKindConfigurator(new DbKindConfigurator(id, configType, scanType, *this, m_dbClient, baseDir + OLD_DB_KIND_DIR));
-			m_configurators.push_back(oldDbKindConfigurator);
+			configurators.push_back(CreateConfigurator(OLD_DB_KIND_DIR, id, scanType, configType, baseDir));
 		}
 
-		ConfiguratorPtr dbKindConfigurator(new DbKindConfigurator(id, configType, scanType, *this, m_dbClient, baseDir + DB_KIND_DIR));
-		m_configurators.push_back(dbKindConfigurator);
+		if (dbs & MAINDB)
+			configurators.push_back(CreateConfigurator(DB_KIND_DIR, id, scanType, configType, baseDir));
+		if (dbs & MEDIADB)
+			configurators.push_back(CreateConfigurator(MEDIADB_KIND_DIR, id, scanType, configType, baseDir));
+		if (dbs & TEMPDB)
+			configurators.push_back(CreateConfigurator(TEMPDB_KIND_DIR, id, scanType, configType, baseDir));
+	}
 
-        ConfiguratorPtr mediaDbKindConfigurator(new MediaDbKindConfigurator(id, configType, scanType, *this, m_mediaDbClient, baseDir + MEDIADB_KIND_DIR));
-        m_configurators.push_back(mediaDbKindConfigurator);
+	if (bitmask & DBPERMISSIONS) {
+		if (dbs & MAINDB)
+			configurators.push_back(CreateConfigurator(DB_PERMISSIONS_DIR, id, scanType, configType, baseDir));
+		if (dbs & MEDIADB)
+			configurators.push_back(CreateConfigurator(MEDIADB_PERMISSIONS_DIR, id, scanType, configType, baseDir));
+		if (dbs & TEMPDB)
+			configurators.push_back(CreateConfigurator(TEMPDB_PERMISSIONS_DIR, id, scanType, configType, baseDir));
+	}
 
-		ConfiguratorPtr tempDbKindConfigurator(new TempDbKindConfigurator(id, configType, scanType, *this, m_tempDbClient, baseDir + TEMPDB_KIND_DIR));
-		m_configurators.push_back(tempDbKindConfigurator);
+	if (bitmask & FILECACHE)
+		configurators.push_back(CreateConfigurator(FILE_CACHE_CONFIG_DIR, id, scanType, configType, baseDir));
 
-	}
+	if (bitmask & ACTIVITIES)
+		configurators.push_back(CreateConfigurator(ACTIVITY_CONFIG_DIR, id, scanType, configType, baseDir));
 
-	if (bitmask & DBPERMISSIONS) {
-		ConfiguratorPtr dbPermsConfigurator(new DbPermissionsConfigurator(id, configType, scanType, *this, m_dbClient, baseDir + DB_PERMISSIONS_DIR));
-		m_configurators.push_back(dbPermsConfigurator);
+	if (configurators.size() > first)
+		RequestLane().openConfigurators[id] += configurators.size() - first;
+	for (size_t i = first; i < configurators.size(); i++)
+		configurators[i]->SetPriority(m_priority);
+}
+
+Configurator* BusClient::CreateConfigurator(const char* typeDir, const std::string& id, Configurator::RunType runType, Configurator::ConfigType configType, const std::string& baseDir)
+{
+	const std::string dir = baseDir + typeDir;
+
+	if (typeDir == DB_KIND_DIR || typeDir == OLD_DB_KIND_DIR)
+		return new DbKindConfigurator(id, configType, runType, *this, m_dbClient, dir);
+	if (typeDir == MEDIADB_KIND_DIR)
+		return new MediaDbKindConfigurator(id, configType, runType, *this, m_mediaDbClient, dir);
+	if (typeDir == TEMPDB_KIND_DIR)
+		return new TempDbKindConfigurator(id, configType, runType, *this, m_tempDbClient, dir);
+	if (typeDir == DB_PERMISSIONS_DIR)
+		return new DbPermissionsConfigurator(id, configType, runType, *this, m_dbClient, dir);
+	if (typeDir == MEDIADB_PERMISSIONS_DIR)
+		return new MediaDbPermissionsConfigurator(id, configType, runType, *this, m_mediaDbClient, dir);
+	if (typeDir == TEMPDB_PERMISSIONS_DIR)
+		return new TempDbPermissionsConfigurator(id, configType, runType, *this, m_tempDbClient, dir);
+	if (typeDir == FILE_CACHE_CONFIG_DIR)
+		return new FileCacheConfigurator(id, configType, runType, *this, dir);
+
+	assert(typeDir == ACTIVITY_CONFIG_DIR);
+	return new ActivityConfigurator(id, configType, runType, *this, dir);
+}
 
-        ConfiguratorPtr mediaDbPermsConfigurator(new MediaDbPermissionsConfigurator(id, configType, scanType, *this, m_mediaDbClient, baseDir + MEDIADB_PERMISSIONS_DIR));
-        m_configurators.push_back(mediaDbPermsConfigurator);
+// realpath() of path - a file that doesn't exist (any more) is resolved
+// through its directory unless mustExist
+static bool resolveConfigPath(const std::string& path, bool mustExist, std::string& resolved)
+{
+	char* real = realpath(path.c_str(), NULL);
+	if (real != NULL) {
+		resolved = real;
+		free(real);
 
-		ConfiguratorPtr tempDbPermsConfigurator(new TempDbPermissionsConfigurator(id, configType, scanType, *this, m_tempDbClient, baseDir + TEMPDB_PERMISSIONS_DIR));
-		m_configurators.push_back(tempDbPermsConfigurator);
+		struct stat buf;
+		return stat(resolved.c_str(), &buf) == 0 && S_ISREG(buf.st_mode);
 	}
+	if (mustExist || errno != ENOENT)
+		return false;
+
+	std::string::size_type slash = path.rfind('/');
+	if (slash == std::string::npos)
+		return false;
+	std::string name = path.substr(slash + 1);
+	if (name.empty() || name == "." || name == "..")
+		return false;
 
-	if (bitmask & FILECACHE) {
-		ConfiguratorPtr fileCacheConfigurator(new FileCacheConfigurator(id, configType, scanType, *this, baseDir + FILE_CACHE_CONFIG_DIR));
-		m_configurators.push_back(fileCacheConfigurator);
+	real = realpath(path.substr(0, slash).c_str(), NULL);
+	if (real == NULL)
+		return false;
+	resolved = std::string(real) + "/" + name;
+	free(real);
+	return true;
+}
+
+const char* BusClient::TypeDir(const std::string& baseDir, std::string& path, bool mustExist) const
+{
+	const char* const typeDirs[] = {
+		DB_KIND_DIR, MEDIADB_KIND_DIR, TEMPDB_KIND_DIR,
+		DB_PERMISSIONS_DIR, MEDIADB_PERMISSIONS_DIR, TEMPDB_PERMISSIONS_DIR,
+		FILE_CACHE_CONFIG_DIR, ACTIVITY_CONFIG_DIR, OLD_DB_KIND_DIR,
+	};
+
+	// compared resolved - a "../" or a symlink can't lead out of the directory
+	std::string resolved;
+	if (!resolveConfigPath(path, mustExist, resolved))
+		return NULL;
+
+	for (size_t i = 0; i < sizeof(typeDirs) / sizeof(typeDirs[0]); i++) {
+		char* real = realpath((baseDir + typeDirs[i]).c_str(), NULL);
+		if (real == NULL)
+			continue;
+		std::string dir = std::string(real) + "/";
+		free(real);
+
+		if (resolved.compare(0, dir.size(), dir) == 0) {
+			path = baseDir + typeDirs[i] + "/" + resolved.substr(dir.size());
+			return typeDirs[i];
+		}
 	}
+	return NULL;
+}
 
-	if (bitmask & ACTIVITIES) {
-		ActivityConfigurator *activityConfigurator = new ActivityConfigurator(id, configType, scanType, *this, baseDir + ACTIVITY_CONFIG_DIR);
-		m_configurators.push_back(activityConfigurator);
+void BusClient::ConfigureFiles(const MojString& _id, const std::string& baseDir, Configurator::ConfigType configType, const ListedConfigCollection& configs)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	const std::string id(_id.data(), _id.length());
+	Lane& lane = RequestLane();
+	CancelShutdown();
+
+	// one configurator per configuration directory & operation - each is
+	// handed its files & doesn't walk the directory
+	typedef std::map<std::pair<const char*, Configurator::RunType>, Configurator*> ConfiguratorMap;
+	ConfiguratorMap configurators;
+	bool configuring = false;
+	for (ListedConfigCollection::const_iterator i = configs.begin(); i != configs.end(); ++i) {
+		Configurator*& configurator = configurators[std::make_pair(i->typeDir, i->runType)];
+		if (configurator == NULL) {
+			configurator = CreateConfigurator(i->typeDir, id, i->runType, configType, baseDir);
+			configurator->SetPriority(m_priority);
+			configurator->ExcludeFromReadiness();
+			lane.configurators.push_back(configurator);
+			lane.openConfigurators[id]++;
+		}
+		configurator->AddConfig(i->path);
+		if (i->runType != Configurator::RemoveConfiguration)
+			configuring = true;
 	}
+
+	if (configuring)
+		PromoteDeferredKinds(id);
+	LOG_DEBUG("%zd listed configurations of '%s' queued", configs.size(), id.c_str());
 }
 
-void BusClient::Scan(ConfigurationMode confmode, const MojString &appId, PackageType type, PackageLocation location)
+void BusClient::Scan(ConfigurationMode confmode, const MojString &appId, PackageType type, PackageLocation location, ScanTypes bitmask, DbTargets dbs)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
@@ -618,7 +1683,14 @@ void BusClient::Scan(ConfigurationMode confmode, const MojString &appId, Package
 		break;
 	}
 
-	ScanDir(appId, mode, confPath, DBKINDS | DBPERMISSIONS | FILECACHE | ACTIVITIES, PackageTypeToConfigType(type));
+	ConfiguratorCollection& configurators = RequestLane().configurators;
+	size_t first = configurators.size();
+	ScanDir(appId, mode, confPath, bitmask, PackageTypeToConfigType(type), None, dbs);
+	if (bitmask != ALL_TYPES || dbs != ALL_DBS) {
+		for (size_t i = first; i < configurators.size(); i++)
+			configurators[i]->ExcludeFromReadiness();
+	}
+	PromoteDeferredKinds(std::string(appId.data(), appId.length()));
 
 	LOG_DEBUG("Scan of %s finished", appId.data());
 }
@@ -627,43 +1699,302 @@ void BusClient::Unconfigure(const MojString &appId, PackageType type, PackageLoc
 {
 	std::string confPath = appConfDir(appId, type, location);
 
+	m_readiness.Forget(std::string(appId.data(), appId.length()));
+	if (bitmask & ACTIVITIES)
+		m_firstUse.Forget(std::string(appId.data(), appId.length()));
 	ScanDir(appId, Configurator::RemoveConfiguration, confPath, bitmask, PackageTypeToConfigType(type));
 	LOG_DEBUG("Removal of %s finished", appId.data());
 }
 
+ConfiguratorStats& BusClient::Stats()
+{
+	return m_stats;
+}
+
+Tracer& BusClient::Trace()
+{
+	return m_tracer;
+}
+
+OwnerCosts& BusClient::Costs()
+{
+	return m_ownerCosts;
+}
+
+OwnerReadiness& BusClient::Readiness()
+{
+	return m_readiness;
+}
+
+FirstUseQueue& BusClient::FirstUse()
+{
+	return m_firstUse;
+}
+
+void BusClient::CancelShutdown()
+{
+	if (m_shuttingDown) {
+		LOG_DEBUG("Aborting shutdown - request received");
+		assert(m_timerTimeout != 0);
+		g_source_remove(m_timerTimeout);
+		m_timerTimeout = 0;
+		assert(m_shuttingDown);
+		m_shuttingDown = false;
+	}
+}
+
+void BusClient::ReleaseFirstUseQueue()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	// a copy - entries leave the queue as their activities are created
+	const FirstUseQueue::EntryList entries = m_firstUse.Entries();
+	if (entries.empty())
+		return;
+
+	LOG_DEBUG("Registering %zd activities held back for first use", entries.size());
+	CancelShutdown();
+
+	// one configurator per directory the activities were found in, so that
+	// they keep the creator they would have had in the walk
+	typedef std::map<std::string, ActivityConfigurator*> DirectoryMap;
+	DirectoryMap byDirectory;
+	Lane& lane = RequestLane();
+	for (FirstUseQueue::EntryList::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+		ActivityConfigurator*& configurator = byDirectory[i->directory];
+		if (configurator == NULL) {
+			configurator = new ActivityConfigurator(i->id, i->type, Configurator::Configure, *this, i->directory);
+			configurator->SetPriority(m_priority);
+			lane.configurators.push_back(configurator);
+			lane.openConfigurators[i->id]++;
+		}
+		configurator->AddConfig(i->path);
+	}
+}
+
+void BusClient::PublishReadyOwners()
+{
+	// until every configurator has scanned an owner may still have configs
+	// nobody knows about
+	for (int p = 0; p < Configurator::PriorityCount; p++) {
+		const ConfiguratorCollection& configurators = m_lanes[p].configurators;
+		for (ConfiguratorCollection::const_iterator i = configurators.begin(); i != configurators.end(); ++i) {
+			if (i->get() && !(*i)->Scanned())
+				return;
+		}
+	}
+
+	std::vector<std::string> ready;
+	m_readiness.TakeReady(ready);
+	for (std::vector<std::string>::const_iterator i = ready.begin(); i != ready.end(); ++i) {
+		LOG_DEBUG("%s is configured", i->c_str());
+		for (int p = 0; p < Configurator::PriorityCount; p++)
+			m_lanes[p].progress.OwnerConfigured(*i);
+	}
+}
+
+MojErr BusClient::StatsToJson(MojObject& stats) const
+{
+	MojErr err = m_stats.ToJson(stats);
+	MojErrCheck(err);
+
+	// queue depths
+	MojObject queues(MojObject::TypeObject);
+	const Lane& interactive = m_lanes[Configurator::Interactive];
+	const Lane& bulk = m_lanes[Configurator::Bulk];
+	err = queues.putInt("configurators", interactive.configurators.size() - interactive.completed +
+			bulk.configurators.size() - bulk.completed); MojErrCheck(err);
+	err = queues.putInt("interactiveConfigurators", interactive.configurators.size() - interactive.completed); MojErrCheck(err);
+	err = queues.putInt("pendingCalls", interactive.pending.size() + bulk.pending.size()); MojErrCheck(err);
+	err = queues.putInt("deferredKinds", m_deferredKinds.size()); MojErrCheck(err);
+	err = stats.put("queues", queues);
+	MojErrCheck(err);
+
+	MojObject callbacks(MojObject::TypeObject);
+	err = CallbackPool::ToJson(callbacks);
+	MojErrCheck(err);
+	err = stats.put("callbacks", callbacks);
+	MojErrCheck(err);
+
+	MojObject paths(MojObject::TypeObject);
+	err = PathTable::ToJson(paths);
+	MojErrCheck(err);
+	err = stats.put("paths", paths);
+	MojErrCheck(err);
+
+	const ResultLedger& interactiveLedger = Configurator::Ledger(Configurator::Interactive);
+	const ResultLedger& bulkLedger = Configurator::Ledger(Configurator::Bulk);
+	err = stats.putInt("configured", interactiveLedger.Count(ResultLedger::Ok) + bulkLedger.Count(ResultLedger::Ok)); MojErrCheck(err);
+	err = stats.putInt("failed", interactiveLedger.Count(ResultLedger::Failed) + bulkLedger.Count(ResultLedger::Failed)); MojErrCheck(err);
+	err = stats.putInt("deferred", interactiveLedger.Count(ResultLedger::Deferred) + bulkLedger.Count(ResultLedger::Deferred)); MojErrCheck(err);
+	return MojErrNone;
+}
+
+gboolean BusClient::DumpStatsCallback(gpointer data)
+{
+	BusClient* client = static_cast<BusClient*>(data);
+	MojObject stats(MojObject::TypeObject);
+	MojString json;
+
+	if (client->StatsToJson(stats) == MojErrNone && stats.toJson(json) == MojErrNone)
+		LOG_INFO(MSGID_STATS, 0, "%s", json.data());
+	client->DumpEvents();
+	return true;
+}
+
+void BusClient::DumpEvents() const
+{
+	std::string eventsFile = Configurator::ConfCacheDir() + EVENTS_FILE;
+
+	if (EventRing::Dump(eventsFile) == MojErrNone) {
+		LOG_WARNING(MSGID_EVENT_RING, 1,
+				PMLOGKS("file", eventsFile.c_str()),
+				"Recent configurator events written to %s", eventsFile.c_str());
+	}
+}
+
+void BusClient::ScanPackages(PackageType type)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	std::string packagesDir = m_rootDir + BASE_ROOT + BASE_PALM_OFFSET + (type == Application ? APPS_DIR : SERVICES_DIR);
+	DIR* dp = opendir(packagesDir.c_str());
+	if (dp == NULL) {
+		LOG_DEBUG("No packages in %s", packagesDir.c_str());
+		return;
+	}
+
+	// sorted so that runs over the same tree are comparable
+	std::vector<std::string> ids;
+	struct dirent* dirp;
+	while ((dirp = readdir(dp)) != NULL) {
+		if (dirp->d_name[0] != '.')
+			ids.push_back(dirp->d_name);
+	}
+	closedir(dp);
+	std::sort(ids.begin(), ids.end());
+
+	for (std::vector<std::string>::const_iterator i = ids.begin(); i != ids.end(); ++i) {
+		MojString appId;
+		if (appId.assign(i->c_str()) != MojErrNone)
+			continue;
+		Scan(LazyScan, appId, type, System);
+	}
+}
+
 void BusClient::RunNextConfigurator()
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
 	// Schedule an event to run the next configurator once the stack is unwound.
-	g_idle_add(&BusClient::IterateConfiguratorsCallback, this);
+	// There's only ever one source - calls while it is pending (or running)
+	// just ask it for another tick.
+	m_workRequested = true;
+	if (m_workSource == 0)
+		m_workSource = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, &BusClient::IterateConfiguratorsCallback, this, &BusClient::WorkSourceRemoved);
+}
+
+void BusClient::WorkSourceRemoved(gpointer data)
+{
+	static_cast<BusClient*>(data)->m_workSource = 0;
+}
+
+BusClient::Lane& BusClient::RequestLane()
+{
+	return m_lanes[m_priority];
+}
+
+bool BusClient::LaneBusy(Configurator::Priority priority) const
+{
+	const Lane& lane = m_lanes[priority];
+	return lane.completed != lane.configurators.size();
 }
 
 gboolean BusClient::IterateConfiguratorsCallback(gpointer data)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 	BusClient* client = static_cast<BusClient*>(data);
+	TraceSpan span(client->m_tracer, "tick", "loop");
+	client->m_workRequested = false;
 
-	if (client->m_configuratorsCompleted == client->m_configurators.size()) {
+	bool interactiveBusy = client->LaneBusy(Configurator::Interactive);
+	bool bulkBusy = client->LaneBusy(Configurator::Bulk);
+
+	if (!interactiveBusy && !bulkBusy) {
 		if (!client->m_shuttingDown) {
-			LOG_DEBUG("No more configurators left (%d configurations completed, %d configurations failed), shutting down.", Configurator::ConfigureOk().size(), Configurator::ConfigureFailure().size());
+			const ResultLedger& ledger = Configurator::Ledger(Configurator::Bulk);
+			LOG_DEBUG("No more configurators left (%d configurations completed, %d configurations failed, %d deferred), shutting down.", ledger.Count(ResultLedger::Ok), ledger.Count(ResultLedger::Failed), ledger.Count(ResultLedger::Deferred));
 			client->ScheduleShutdown();
-			return client->m_msg.get() != NULL;
+			return client->m_lanes[Configurator::Interactive].msg.get() != NULL ||
+					client->m_lanes[Configurator::Bulk].msg.get() != NULL ||
+					client->m_workRequested;
 		}
-		return false;
+		return client->m_workRequested;
+	}
+
+	// an install finishing in the middle of the sweep is answered right away
+	if (!interactiveBusy && client->m_lanes[Configurator::Interactive].msg.get())
+		interactiveBusy = client->CompleteLane(Configurator::Interactive);
+	if (!bulkBusy && client->m_lanes[Configurator::Bulk].msg.get())
+		bulkBusy = client->CompleteLane(Configurator::Bulk);
+
+	// results of the last ticks go out in batches
+	for (int p = 0; p < Configurator::PriorityCount; p++)
+		client->m_lanes[p].progress.FlushFiles(false);
+	client->PublishReadyOwners();
+
+	// as many rounds as fit in the budget, then back to the main loop so
+	// that the replies get dispatched
+	gint64 deadline = g_get_monotonic_time() + client->m_tickBudget;
+	unsigned int rounds = 0;
+	bool configurationsRemaining;
+	do {
+		configurationsRemaining = client->AdvanceLanes(interactiveBusy, bulkBusy);
+		rounds++;
+	} while (configurationsRemaining && g_get_monotonic_time() < deadline);
+	LOG_DEBUG("%u rounds in this tick", rounds);
+
+	// keep the source while there is work - or somebody asked for another go
+	return configurationsRemaining || client->m_workRequested;
+}
+
+// one round - returns whether or not there are more configurations remaining
+bool BusClient::AdvanceLanes(bool interactiveBusy, bool bulkBusy)
+{
+	bool configurationsRemaining = false;
+
+	// the interactive lane goes first - while it still has configurations
+	// to send the bulk sweep only gets every BULK_SHARE-th round
+	bool interactiveSending = interactiveBusy && RunLane(Configurator::Interactive);
+	if (interactiveSending)
+		configurationsRemaining = true;
+
+	if (!interactiveSending || ++m_bulkTicks % BULK_SHARE == 0) {
+		if (bulkBusy && RunLane(Configurator::Bulk))
+			configurationsRemaining = true;
+	} else if (bulkBusy) {
+		configurationsRemaining = true;
 	}
+	return configurationsRemaining;
+}
+
+// advances every configurator of the lane by one file - returns whether any
+// still has configurations to send
+bool BusClient::RunLane(Configurator::Priority priority)
+{
+	Lane& lane = m_lanes[priority];
+	bool configurationsRemaining = false;
 
-	gboolean configurationsRemaining = FALSE;
 	// iterate through 1 file in each configurator
-	for (int i = 0, ni = client->m_configurators.size(); i < ni; i++) {
+	for (size_t i = 0; i < lane.configurators.size(); i++) {
 		bool exceptionThrown = true;
 		try {
-				ConfiguratorPtr configurator = client->m_configurators[i];
+				ConfiguratorPtr configurator = lane.configurators[i];
 				if (configurator.get() == NULL)
 					continue;
 
 				if (!configurator->Run())
-					configurationsRemaining = TRUE;
+					configurationsRemaining = true;
 				exceptionThrown = false;
 		} catch (const std::exception& e) {
 			LOG_CRITICAL(MSGID_BUS_CLIENT_ERROR, 1,
@@ -675,88 +2006,156 @@ gboolean BusClient::IterateConfiguratorsCallback(gpointer data)
 
 		// If an exception was thrown, remove it from the queue and keep going
 		if (exceptionThrown) {
-			client->ConfiguratorComplete(i);
+			ConfiguratorComplete(lane, lane.configurators.begin() + i);
 		}
 	}
-
-	// return whether or not there are more configurations remaining
 	return configurationsRemaining;
 }
 
-void BusClient::ConfiguratorComplete(ConfiguratorCollection::iterator configurator)
+void BusClient::ConfiguratorComplete(Lane& lane, ConfiguratorCollection::iterator configurator)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	LOG_DEBUG("... configurator %s complete (%p), %zd left.", (*configurator)->ConfiguratorName(), configurator->get(), m_configurators.size() - 1);
+	LOG_DEBUG("... configurator %s complete (%p), %zd left.", (*configurator)->ConfiguratorName(), configurator->get(), lane.configurators.size() - lane.completed - 1);
+
+	const std::string id = (*configurator)->Id();
+	lane.progress.ConfiguratorDone((*configurator)->ConfiguratorName(), id);
+	std::map<std::string, unsigned int>::iterator open = lane.openConfigurators.find(id);
+	if (open != lane.openConfigurators.end() && --open->second == 0) {
+		lane.openConfigurators.erase(open);
+		lane.progress.AppDone(id);
+	}
+
 	configurator->reset();
-	m_configuratorsCompleted++;
+	lane.completed++;
 	RunNextConfigurator();
 }
 
 void BusClient::ConfiguratorComplete(Configurator* configurator)
 {
+	Lane& lane = m_lanes[configurator->GetPriority()];
 	ConfiguratorCollection::iterator i, ni;
-	for (i = m_configurators.begin(), ni = m_configurators.end(); i != ni; i++) {
+	for (i = lane.configurators.begin(), ni = lane.configurators.end(); i != ni; i++) {
 		ConfiguratorPtr ptr(*i);
 		if (ptr.get() && &(*ptr) == configurator) {
-			ConfiguratorComplete(i);
+			ConfiguratorComplete(lane, i);
 			return;
 		}
 	}
 }
 
-void BusClient::ConfiguratorComplete(int configuratorIndex)
-{
-	ConfiguratorCollection::iterator i = m_configurators.begin() + configuratorIndex;
-	ConfiguratorComplete(i);
-}
-
-void BusClient::ScheduleShutdown()
+// replies to the lane's request & starts its next one - returns whether the
+// lane has work again
+bool BusClient::CompleteLane(Configurator::Priority priority)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	Lane& lane = m_lanes[priority];
+	const ResultLedger& ledger = Configurator::Ledger(priority);
+
+	// the events leading up to a failure are only formatted now
+	if (ledger.Count(ResultLedger::Failed) != 0)
+		DumpEvents();
+
+	PublishReadyOwners();
+
 	// Reply to the "run" message now that we're done
-	if (m_launchedAsService && m_msg.get()) {
-		const Configurator::ConfigCollection& ok = Configurator::ConfigureOk();
-		const Configurator::ConfigCollection& failed = Configurator::ConfigureFailure();
+	if (m_launchedAsService && lane.msg.get()) {
+		size_t ok = ledger.Count(ResultLedger::Ok);
+		size_t failed = ledger.Count(ResultLedger::Failed);
+		size_t deferred = ledger.Count(ResultLedger::Deferred);
+
+		// the last updates go out ahead of the final reply
+		lane.progress.FlushFiles(true);
+		lane.progress.Stop();
 
-		if (m_wrongAplication) {
+		if (lane.wrongApplication) {
 			MojString response;
 			response.appendFormat("Application or service doesn't exist");
-			m_wrongAplication = false;
-            if(m_msg->replyError(MojErrInternal, response.data()) != MojErrNone) {
+            if(lane.msg->replyError(MojErrInternal, response.data()) != MojErrNone) {
                 LOG_WARNING(MSGID_SHUTDOWN_ERROR, 1, PMLOGKS("Response", response.data()), "Application or service doesn't exist");
             }
-		} else if (!failed.empty()) {
-			MojString response;
-			response.appendFormat("Partial configuration - %zu ok, %zu failed", ok.size(), failed.size());
-            if(m_msg->replyError(MojErrInternal, response.data()) != MojErrNone) {
-                LOG_WARNING(MSGID_SHUTDOWN_ERROR, 1, PMLOGKS("Response", response.data()), "Partial configuration");
+		} else if (failed != 0) {
+			MojString errorText;
+			errorText.appendFormat("Partial configuration - %zu ok, %zu failed", ok, failed);
+			if (deferred != 0)
+				errorText.appendFormat(", %zu deferred", deferred);
+
+			MojErr err;
+			if (lane.replyLedger) {
+				// replyError() can't carry a payload - build the error reply by hand
+				MojObject response(MojObject::TypeObject);
+				response.putBool("returnValue", false);
+				response.putInt("errorCode", MojErrInternal);
+				response.putString("errorText", errorText.data());
+				putLedger(response, ledger);
+				err = lane.msg->reply(response);
+			} else {
+				err = lane.msg->replyError(MojErrInternal, errorText.data());
+			}
+            if(err != MojErrNone) {
+                LOG_WARNING(MSGID_SHUTDOWN_ERROR, 1, PMLOGKS("Response", errorText.data()), "Partial configuration");
             }
 		} else {
 			MojObject response;
-			response.putInt("configured", ok.size());
-            if(m_msg->replySuccess(response) != MojErrNone) {
+			response.putInt("configured", ok);
+			if (deferred != 0)
+				response.putInt("deferred", deferred);
+			if (lane.replyLedger)
+				putLedger(response, ledger);
+            if(lane.msg->replySuccess(response) != MojErrNone) {
                 LOG_WARNING(MSGID_SHUTDOWN_ERROR, 0, "Configured");
             }
 		}
-		m_msg.reset();
 	}
 
-	if (!m_pending.empty()) {
-		LOG_DEBUG("%d pending service calls to handle remaining", m_pending.size());
+	lane.msg.reset();
+	lane.wrongApplication = false;
+	lane.replyLedger = false;
+	lane.completed = 0;
+	lane.configurators.clear();
+	lane.openConfigurators.clear();
+	Configurator::ResetConfigStats(priority);
+	Configurator::ReleaseClaims(priority);
 
-		// still more pending work
-		m_configuratorsCompleted = 0;
-		m_configurators.clear();
-		Configurator::ResetConfigStats();
+	if (lane.pending.empty())
+		return false;
 
-		const PendingWork &pending = m_pending.back();
-		(pending.instance->*(pending.callback))(pending.msg.get(), pending.payload);
+	LOG_DEBUG("%d pending service calls to handle remaining", lane.pending.size());
 
-		m_pending.pop_back();
-		return;
+	// still more pending work
+	PendingWork pending = lane.pending.front();
+	lane.pending.pop_front();
+	(pending.instance->*(pending.callback))(pending.msg.get(), pending.payload);
+	return LaneBusy(priority) || lane.msg.get() != NULL;
+}
+
+void BusClient::ScheduleShutdown()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	// nothing is running in either lane - counts of failed owners start over
+	m_readiness.Reset();
+	m_firstUse.Save();
+
+	bool started = false;
+	for (int p = 0; p < Configurator::PriorityCount; p++) {
+		if (CompleteLane(static_cast<Configurator::Priority>(p)))
+			started = true;
 	}
 
+	// the run's callbacks are all gone - hand their memory back in one go
+	if (!started && CallbackPool::Reset())
+		LOG_DEBUG("Released callback pool");
+
+	if (started)
+		return;
+
+	// index rebuilds held back from the sweep get their turn now
+	if (RunDeferredKinds())
+		return;
+
+	DropDeferredSends();
 	LOG_DEBUG("No more pending service calls to handle - scheduling shutdown");
 
 	// Schedule an event to shutdown once the stack is unwound.
@@ -777,6 +2176,120 @@ void BusClient::ScheduleShutdown()
 	m_shuttingDown = true;
 }
 
+void BusClient::DeferKindUpdate(DbKindConfigurator *configurator, const std::string& filePath, const std::string& owner)
+{
+	DeferredKind deferred;
+	deferred.configurator.reset(configurator);
+	deferred.filePath = filePath;
+	deferred.owner = owner;
+	m_deferredKinds.push_back(deferred);
+
+	// the owner isn't configured until the update has gone through
+	m_readiness.KindDeferred(owner);
+}
+
+// returns whether or not the post-boot phase still has work outstanding
+bool BusClient::RunDeferredKinds()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	if (m_deferredKinds.empty() && !m_deferredKindInFlight)
+		return false;
+
+	if (!m_deferredKindInFlight && m_deferredKindTimeout == 0) {
+		LOG_DEBUG("Starting post-boot phase - %zu re-indexing kind updates deferred", m_deferredKinds.size());
+		ScheduleDeferredKind(DEFERRED_KIND_INTERVAL);
+	}
+	return true;
+}
+
+void BusClient::ScheduleDeferredKind(unsigned int delay)
+{
+	if (m_deferredKindTimeout != 0)
+		g_source_remove(m_deferredKindTimeout);
+
+	// low priority so that bus replies & interactive requests always go first
+	m_deferredKindTimeout = g_timeout_add_full(G_PRIORITY_LOW, delay, &BusClient::DeferredKindCallback, this, NULL);
+}
+
+void BusClient::PromoteDeferredKinds(const std::string& owner)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	// the owner is being scanned because it is about to be used - its
+	// deferred kinds go to the front of the queue & skip the throttle
+	DeferredKindQueue promoted;
+	for (DeferredKindQueue::iterator i = m_deferredKinds.begin(); i != m_deferredKinds.end(); ) {
+		if (i->owner == owner) {
+			promoted.push_back(*i);
+			i = m_deferredKinds.erase(i);
+		} else {
+			++i;
+		}
+	}
+
+	if (promoted.empty())
+		return;
+
+	LOG_DEBUG("Promoting %zu deferred kind updates for %s", promoted.size(), owner.c_str());
+	m_deferredKinds.insert(m_deferredKinds.begin(), promoted.begin(), promoted.end());
+	if (!m_deferredKindInFlight)
+		ScheduleDeferredKind(0);
+}
+
+gboolean BusClient::DeferredKindCallback(gpointer data)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+	BusClient* client = static_cast<BusClient*>(data);
+	client->m_deferredKindTimeout = 0;
+
+	// the reply to the previous update has been recorded by now
+	client->PublishReadyOwners();
+
+	while (!client->m_deferredKinds.empty()) {
+		DeferredKind deferred = client->m_deferredKinds.front();
+		client->m_deferredKinds.pop_front();
+
+		LOG_DEBUG("Applying deferred kind update %s", deferred.filePath.c_str());
+		client->m_deferredKindInFlight = true;
+
+		DbKindConfigurator* configurator = static_cast<DbKindConfigurator*>(deferred.configurator.get());
+		client->m_deferredKindPath = deferred.filePath;
+		MojErr err = configurator->ApplyDeferred(deferred.filePath, deferred.owner);
+		if (err == MojErrNone)
+			return false; // only one in flight - wait for db8 to reply
+
+		client->m_deferredKindInFlight = false;
+		// held by db8's breaker - reported once it has been sent after all
+		if (err != MojErrInProgress)
+			client->m_readiness.DeferredKindDone(deferred.owner, false);
+	}
+
+	LOG_DEBUG("Post-boot phase complete");
+	client->RunNextConfigurator();
+	return false;
+}
+
+void BusClient::DeferredKindComplete(const std::string& filePath, const std::string& owner, bool success)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	m_readiness.DeferredKindDone(owner, success);
+
+	// one that db8's breaker held & sent later isn't the one in flight
+	if (!m_deferredKindInFlight || filePath != m_deferredKindPath)
+		return;
+
+	m_deferredKindInFlight = false;
+	if (!m_deferredKinds.empty()) {
+		ScheduleDeferredKind(DEFERRED_KIND_INTERVAL);
+		return;
+	}
+
+	LOG_DEBUG("Post-boot phase complete");
+	RunNextConfigurator();
+}
+
 gboolean BusClient::ShutdownCallback(gpointer data)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
@@ -29,8 +29,17 @@
 #include "db/MojDbServiceClient.h"
 #include "luna/MojLunaService.h"
 #include "Configurator.h"
+#include "ConfiguratorStats.h"
+#include "FirstUseQueue.h"
+#include "OwnerCosts.h"
+#include "OwnerReadiness.h"
+#include "ProgressReporter.h"
 #include "Flags.h"
+#include "Tracer.h"
 #include "Log.h"
+#include "ServiceBackend.h"
+#include <deque>
+#include <map>
 #include <vector>
 
 class BusClient : public MojReactorApp<MojGmainReactor>
@@ -42,25 +51,68 @@ public:
 		DBPERMISSIONS = 1 << 2,
 		/*WATCHES      = 1 << 2,*/ // deprecated
 		ACTIVITIES   = 1 << 3,
+		ALL_TYPES    = DBKINDS | FILECACHE | DBPERMISSIONS | ACTIVITIES,
 	};
 	DECLARE_FLAGS(ScanTypes, ScanType);
 
+	// the db8 instances that kinds & permissions are scanned for
+	enum DbTarget {
+		MAINDB       = 1 << 0,
+		MEDIADB      = 1 << 1,
+		TEMPDB       = 1 << 2,
+		ALL_DBS      = MAINDB | MEDIADB | TEMPDB,
+	};
+	DECLARE_FLAGS(DbTargets, DbTarget);
+
 	typedef enum {
 		None                 = 0,
 		DeprecatedDbKind,
 	} AdditionalFileType;
 	DECLARE_FLAGS(AdditionalFileTypes, AdditionalFileType);
 
+	/**
+	 * How requests to a target service are treated - configurable per
+	 * service name in SETTINGS_FILE, e.g.
+	 * { "timeout": 20000, "services": { "com.palm.db": { "timeout": 60000, "retries": 1 } } }
+	 */
+	struct ServicePolicy {
+		unsigned int timeout;   /// ms to wait for a reply
+		unsigned int retries;   /// re-sends after a timeout
+		unsigned int backoff;   /// ms - base of the exponential retry backoff
+		unsigned int breakerThreshold; /// consecutive failures that open the breaker
+		unsigned int probeInterval;    /// ms before an open breaker lets a probe through
+		unsigned int readyTimeout;     /// ms to hold configurations until the service registers
+	};
+
 	BusClient();
 	virtual ~BusClient();
 
 	MojDbClient&						GetDbClient();
-	MojRefCountedPtr<MojServiceRequest>	CreateRequest();
-	MojRefCountedPtr<MojServiceRequest>	CreateRequest(const char *forgedAppId);
+	MojErr								Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId = NULL, MojUInt32 numReplies = 1);
 	virtual MojErr						open();
 	virtual MojErr						handleArgs(const StringVec& args);
 	void								ConfiguratorComplete(Configurator *configurator);
-	void								ConfiguratorComplete(int configuratorIndex);
+	void								DeferKindUpdate(DbKindConfigurator *configurator, const std::string& filePath, const std::string& owner);
+	void								DeferredKindComplete(const std::string& filePath, const std::string& owner, bool success);
+	void								RunNextConfigurator();
+	const ServicePolicy&				Policy(const std::string& serviceName) const;
+	bool								AllowRequest(const std::string& serviceName);
+	void								RecordResult(const std::string& serviceName, bool unavailable);
+	// a config turned away by the service's breaker - sent again once a probe
+	// finds the service back
+	void								DeferSend(Configurator* configurator, const std::string& serviceName, const std::string& filePath);
+	// whether the bus reports the service as registered - true for services
+	// nobody waited on
+	bool								ServiceConnected(const std::string& serviceName) const;
+	bool								ServiceReady(const std::string& serviceName);
+	void								ServiceStatusChanged(const std::string& serviceName, bool connected);
+	void								ServiceWaitExpired(const std::string& serviceName);
+	ConfiguratorStats&					Stats();
+	MojErr								StatsToJson(MojObject& stats) const;
+	Tracer&								Trace();
+	OwnerCosts&							Costs();
+	OwnerReadiness&						Readiness();
+	FirstUseQueue&						FirstUse();
 
 private:
 	typedef enum {
@@ -84,13 +136,20 @@ private:
 		BusMethods(BusClient& client);
 
 	private:
-		bool WorkEnqueued(Callback callback, MojServiceMessage *msg, MojObject& payload);
+		// queues the request if its lane is busy - otherwise makes it the lane
+		// that the request's configurators go to
+		bool WorkEnqueued(Configurator::Priority priority, Callback callback, MojServiceMessage *msg, MojObject& payload);
 
 		MojErr Run(MojServiceMessage* msg, MojObject& payload);
 		MojErr Rescan(MojServiceMessage* msg, MojObject& payload);
 		MojErr Scan(MojServiceMessage* msg, MojObject& payload);
 		MojErr ScanRequest(MojServiceMessage* msg, MojObject& payload, ConfigurationMode confmode);
 		MojErr Unconfigure(MojServiceMessage* msg, MojObject& payload);
+		MojErr ConfigureFiles(MojServiceMessage* msg, MojObject& payload);
+		MojErr FirstUseComplete(MojServiceMessage* msg, MojObject& payload);
+		MojErr Stats(MojServiceMessage* msg, MojObject& payload);
+		MojErr Owners(MojServiceMessage* msg, MojObject& payload);
+		MojErr IsConfigured(MojServiceMessage* msg, MojObject& payload);
 
 		BusClient& m_client;
 	};
@@ -102,7 +161,96 @@ private:
 		MojObject payload;
 	};
 
-	typedef std::vector<PendingWork> PendingWorkCollection;
+	// served in arrival order - an unconfigure & a later scan of the same
+	// app must not swap places
+	typedef std::deque<PendingWork> PendingWorkCollection;
+
+	// a file of a configureFiles request
+	struct ListedConfig {
+		std::string path;
+		Configurator::RunType runType;
+		const char* typeDir;    /// the configuration directory it is in
+	};
+
+	typedef std::vector<ListedConfig> ListedConfigCollection;
+
+	// an app of a scan or rescan request
+	struct ScanEntry {
+		MojString app;
+		PackageType type;
+		PackageLocation location;
+		ScanTypes types;
+		DbTargets dbs;
+	};
+
+	typedef std::vector<ScanEntry> ScanEntryCollection;
+
+	/**
+	 * A kind update that would make db8 rebuild indexes - these are
+	 * held back from the boot sweep & sent one at a time once it is done.
+	 */
+	struct DeferredKind {
+		MojRefCountedPtr<Configurator> configurator;
+		std::string filePath;
+		std::string owner;
+	};
+
+	typedef std::deque<DeferredKind> DeferredKindQueue;
+	typedef std::map<std::string, ServicePolicy> ServicePolicyMap;
+
+	/**
+	 * Fail-fast state of a target service.  After breakerThreshold consecutive
+	 * timeouts or failures while the service isn't registered the breaker opens
+	 * & requests to the service are deferred without a bus send.  probeInterval
+	 * later one of the deferred configs is let through (half-open) - if it
+	 * succeeds the breaker closes & the rest are sent again.
+	 */
+	struct ServiceBreaker {
+		enum State {
+			Closed,
+			Open,
+			HalfOpen,
+		} state;
+		unsigned int failures;
+		gint64 openedAt;
+		unsigned int probeTimer;
+
+		ServiceBreaker() : state(Closed), failures(0), openedAt(0), probeTimer(0) {}
+	};
+
+	typedef std::map<std::string, ServiceBreaker> ServiceBreakerMap;
+
+	struct DeferredSend {
+		MojRefCountedPtr<Configurator> configurator;
+		std::string filePath;
+	};
+
+	typedef std::deque<DeferredSend> DeferredSendQueue;
+	typedef std::map<std::string, DeferredSendQueue> DeferredSendMap;
+
+	struct BreakerProbe {
+		BusClient* client;
+		std::string serviceName;
+	};
+
+	class ServiceStatusWatcher;
+
+	/**
+	 * Registration state of a target service, from a server status
+	 * subscription made the first time a configurator has work for it.
+	 * Configurators for the service are held until it is up (or until
+	 * readyTimeout has passed, in which case the breaker takes over).
+	 */
+	struct ServiceStatus {
+		bool connected;
+		bool gaveUp;
+		unsigned int timer;
+		MojRefCountedPtr<ServiceStatusWatcher> watcher;
+
+		ServiceStatus() : connected(false), gaveUp(false), timer(0) {}
+	};
+
+	typedef std::map<std::string, ServiceStatus> ServiceStatusMap;
 
 	static const char* const SERVICE_NAME;
 	static const char* const ROOT_BASE_DIR;
@@ -122,12 +270,51 @@ private:
 	static const char* const APPS_DIR;
 	static const char* const SERVICES_DIR;
 	static const char* const CONF_SUBDIR;
+	static const char* const SETTINGS_FILE;
+	static const char* const BUS_SERVICE;
+	static const char* const SERVER_STATUS_METHOD;
+	static const char* const MOCK_ARG;
+	static const char* const ROOT_ARG;
+	static const char* const PACKAGES_ARG;
+	static const char* const RESCAN_ARG;
+	static const char* const TRACE_ARG;
+	static const char* const EVENTS_FILE;
+	static const char* const OWNER_REPORT_FILE;
+	static const unsigned int DEFERRED_KIND_INTERVAL;
+
+	static const unsigned int BULK_SHARE;
+	static const unsigned int DEFAULT_TICK_BUDGET;
 
 	typedef MojReactorApp<MojGmainReactor> Base;
 	typedef MojRefCountedPtr<Configurator> ConfiguratorPtr;
 	typedef std::vector<ConfiguratorPtr> ConfiguratorCollection;
 
+	/**
+	 * Requests are served in two lanes: the per-app requests - scan, rescan,
+	 * unconfigure & configureFiles (Interactive) - & the run sweep (Bulk).
+	 * Each lane works on one request at a time & queues the others in arrival
+	 * order, so requests for the same app never overtake each other; the
+	 * scheduler serves the interactive lane first while the bulk sweep keeps
+	 * going.
+	 */
+	struct Lane {
+		ConfiguratorCollection configurators;
+		size_t completed;
+		MojRefCountedPtr<MojServiceMessage> msg;
+		bool wrongApplication;
+		// the caller asked for the per-file results in the reply
+		bool replyLedger;
+		ProgressReporter progress;
+		// configurators not yet complete, per app/service id
+		std::map<std::string, unsigned int> openConfigurators;
+		PendingWorkCollection pending;
+
+		Lane() : completed(0), wrongApplication(false), replyLedger(false) {}
+	};
+
 	std::string appConfDir(const MojString& appId, PackageType type, PackageLocation location);
+	// same, but only tells whether the app is there instead of flagging the lane
+	std::string appConfDir(const MojString& appId, PackageType type, PackageLocation location, bool& exists) const;
 
 	static Configurator::ConfigType PackageTypeToConfigType(PackageType type)
 	{
@@ -142,35 +329,98 @@ private:
 		}
 	}
 
+	void LoadSettings();
+	void WatchService(const std::string& serviceName, ServiceStatus& status);
+	void ArmReadyTimeout(const std::string& serviceName, ServiceStatus& status);
+
 	void Run(ScanTypes bitmask);
-	void Scan(ConfigurationMode confmode, const MojString& appid, PackageType type, PackageLocation location);
-	void ScanDir(const MojString& id, Configurator::RunType scanType, const std::string &dirBase, ScanTypes bitmask, Configurator::ConfigType configType, AdditionalFileTypes types = None);
+	void Scan(ConfigurationMode confmode, const MojString& appid, PackageType type, PackageLocation location, ScanTypes bitmask = ALL_TYPES, DbTargets dbs = ALL_DBS);
+	void ScanDir(const MojString& id, Configurator::RunType scanType, const std::string &dirBase, ScanTypes bitmask, Configurator::ConfigType configType, AdditionalFileTypes types = None, DbTargets dbs = ALL_DBS);
+	// the configurator for typeDir under baseDir - typeDir is one of the *_DIR
+	// constants (compared by address)
+	Configurator* CreateConfigurator(const char* typeDir, const std::string& id, Configurator::RunType runType, Configurator::ConfigType configType, const std::string& baseDir);
+	// the configuration directory under baseDir that path resolves into - NULL
+	// if none or if path isn't a regular file.  path is rewritten to the same
+	// file under the (unresolved) configuration directory.
+	const char* TypeDir(const std::string& baseDir, std::string& path, bool mustExist) const;
+	void ConfigureFiles(const MojString& id, const std::string& baseDir, Configurator::ConfigType configType, const ListedConfigCollection& configs);
 	void Unconfigure(const MojString& appId, PackageType type, PackageLocation location, ScanTypes bitmask);
+	void ScanPackages(PackageType type);
+	void CancelShutdown();
+	// registers the activities that were waiting for first use in the lane of
+	// the firstUseComplete request - they leave the queue as they are created
+	void ReleaseFirstUseQueue();
+
+	Lane& RequestLane();
+	bool  LaneBusy(Configurator::Priority priority) const;
+	bool  RunLane(Configurator::Priority priority);
+	bool  AdvanceLanes(bool interactiveBusy, bool bulkBusy);
+	bool  CompleteLane(Configurator::Priority priority);
 
-	void RunNextConfigurator();
 	void ScheduleShutdown();
+	void PublishReadyOwners();
+	void DumpEvents() const;
+
+	bool RunDeferredKinds();
+	void ScheduleDeferredKind(unsigned int delay);
+	void PromoteDeferredKinds(const std::string& owner);
+
+	void ArmProbe(const std::string& serviceName, ServiceBreaker& breaker);
+	void Probe(const std::string& serviceName);
+	void ReleaseDeferredSends(const std::string& serviceName);
+	void DropDeferredSends();
 
 	static gboolean IterateConfiguratorsCallback(gpointer data);
+	static void     WorkSourceRemoved(gpointer data);
 	static gboolean ShutdownCallback(gpointer data);
+	static gboolean DeferredKindCallback(gpointer data);
+	static gboolean ProbeCallback(gpointer data);
+	static void     ProbeReleased(gpointer data);
+	static gboolean DumpStatsCallback(gpointer data);
 
-	void ConfiguratorComplete(ConfiguratorCollection::iterator configurator);
+	void ConfiguratorComplete(Lane& lane, ConfiguratorCollection::iterator configurator);
 
 	MojLunaService				 m_service;
+	ServiceBackend*				 m_backend;
+	bool						 m_mocked;
 	MojDbServiceClient			 m_dbClient;
 	MojDbServiceClient			 m_mediaDbClient;
     MojDbServiceClient           m_tempDbClient;
-	ConfiguratorCollection       m_configurators;
-	size_t                       m_configuratorsCompleted;
+	Lane                         m_lanes[Configurator::PriorityCount];
+	// the lane of the request being set up - ScanDir adds to it
+	Configurator::Priority       m_priority;
+	unsigned int                 m_bulkTicks;
+	// the one idle source that runs the configurators
+	unsigned int                 m_workSource;
+	bool                         m_workRequested;
+	// us of configurator rounds per tick
+	unsigned int                 m_tickBudget;
 	MojRefCountedPtr<BusMethods> m_methods;
 	bool						 m_launchedAsService;
-	MojRefCountedPtr<MojServiceMessage> m_msg;
 	bool m_shuttingDown;
-	bool m_wrongAplication;
-	PendingWorkCollection m_pending;
 	unsigned int m_timerTimeout;
+	DeferredKindQueue m_deferredKinds;
+	bool m_deferredKindInFlight;
+	std::string m_deferredKindPath;
+	unsigned int m_deferredKindTimeout;
+	ServicePolicy m_defaultPolicy;
+	ServicePolicyMap m_policies;
+	ServiceBreakerMap m_breakers;
+	DeferredSendMap m_deferredSends;
+	ServiceStatusMap m_serviceStatus;
+	ConfiguratorStats m_stats;
+	Tracer m_tracer;
+	OwnerCosts m_ownerCosts;
+	OwnerReadiness m_readiness;
+	FirstUseQueue m_firstUse;
+	unsigned int m_statsSignal;
+	std::string m_rootDir;
+	bool m_scanPackages;
+	std::vector<std::string> m_rescanIds;
 };
 
 DECLARE_OPERATORS_FOR_FLAGS(BusClient::ScanTypes)
 DECLARE_OPERATORS_FOR_FLAGS(BusClient::AdditionalFileTypes)
+DECLARE_OPERATORS_FOR_FLAGS(BusClient::DbTargets)
 
 #endif /* BUSCLIENT_H_ */
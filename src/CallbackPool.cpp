@@ -0,0 +1,122 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "CallbackPool.h"
+
+#include <new>
+#include <stdlib.h>
+
+CallbackPool::FreeBlock* CallbackPool::s_free[CallbackPool::CLASSES];
+std::vector<char*> CallbackPool::s_slabs;
+char* CallbackPool::s_cursor = NULL;
+size_t CallbackPool::s_remaining = 0;
+
+unsigned int CallbackPool::s_allocations = 0;
+unsigned int CallbackPool::s_reused = 0;
+unsigned int CallbackPool::s_oversized = 0;
+unsigned int CallbackPool::s_live = 0;
+unsigned int CallbackPool::s_peak = 0;
+unsigned int CallbackPool::s_resets = 0;
+
+void* CallbackPool::Allocate(size_t size)
+{
+	size_t sizeClass = (size + GRANULE - 1) / GRANULE;
+
+	s_allocations++;
+	if (++s_live > s_peak)
+		s_peak = s_live;
+
+	if (sizeClass >= CLASSES) {
+		s_oversized++;
+		return ::operator new(size);
+	}
+
+	FreeBlock* block = s_free[sizeClass];
+	if (block) {
+		s_free[sizeClass] = block->next;
+		s_reused++;
+		return block;
+	}
+
+	size_t blockSize = sizeClass * GRANULE;
+	if (s_remaining < blockSize) {
+		char* slab = static_cast<char*>(malloc(SLAB_SIZE));
+		if (slab == NULL) {
+			s_live--;
+			throw std::bad_alloc();
+		}
+		s_slabs.push_back(slab);
+		s_cursor = slab;
+		s_remaining = SLAB_SIZE;
+	}
+
+	void* result = s_cursor;
+	s_cursor += blockSize;
+	s_remaining -= blockSize;
+	return result;
+}
+
+void CallbackPool::Release(void* block, size_t size)
+{
+	if (block == NULL)
+		return;
+
+	size_t sizeClass = (size + GRANULE - 1) / GRANULE;
+
+	s_live--;
+	if (sizeClass >= CLASSES) {
+		::operator delete(block);
+		return;
+	}
+
+	FreeBlock* freed = static_cast<FreeBlock*>(block);
+	freed->next = s_free[sizeClass];
+	s_free[sizeClass] = freed;
+}
+
+bool CallbackPool::Reset()
+{
+	if (s_live != 0 || s_slabs.empty())
+		return false;
+
+	for (std::vector<char*>::iterator i = s_slabs.begin(); i != s_slabs.end(); ++i)
+		free(*i);
+	std::vector<char*>().swap(s_slabs);
+
+	for (size_t i = 0; i < CLASSES; i++)
+		s_free[i] = NULL;
+	s_cursor = NULL;
+	s_remaining = 0;
+	s_resets++;
+	return true;
+}
+
+MojErr CallbackPool::ToJson(MojObject& stats)
+{
+	MojErr err;
+
+	err = stats.putInt("allocations", s_allocations); MojErrCheck(err);
+	err = stats.putInt("reused", s_reused); MojErrCheck(err);
+	err = stats.putInt("oversized", s_oversized); MojErrCheck(err);
+	err = stats.putInt("live", s_live); MojErrCheck(err);
+	err = stats.putInt("peak", s_peak); MojErrCheck(err);
+	err = stats.putInt("slabs", s_slabs.size()); MojErrCheck(err);
+	err = stats.putInt("slabBytes", s_slabs.size() * SLAB_SIZE); MojErrCheck(err);
+	err = stats.putInt("resets", s_resets); MojErrCheck(err);
+	return MojErrNone;
+}
@@ -0,0 +1,66 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef CALLBACKPOOL_H_
+#define CALLBACKPOOL_H_
+
+#include "core/MojObject.h"
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Size-class pool for the request callbacks of a run.  Blocks are carved out
+ * of large slabs & recycled through per-size free lists; once the run is over
+ * & no callback is alive any more the slabs are handed back in one go
+ * (Reset), so a long-lived service doesn't keep a heap fragmented by
+ * thousands of small, short-lived objects.
+ */
+class CallbackPool
+{
+public:
+	static void* Allocate(size_t size);
+	static void  Release(void* block, size_t size);
+
+	// frees every slab if nothing is allocated from them - returns whether it did
+	static bool Reset();
+
+	static MojErr ToJson(MojObject& stats);
+
+private:
+	static const size_t GRANULE = 16;
+	static const size_t CLASSES = 32;    // blocks up to 512 bytes
+	static const size_t SLAB_SIZE = 32 * 1024;
+
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	static FreeBlock* s_free[CLASSES];
+	static std::vector<char*> s_slabs;
+	static char* s_cursor;
+	static size_t s_remaining;
+
+	static unsigned int s_allocations;
+	static unsigned int s_reused;
+	static unsigned int s_oversized;
+	static unsigned int s_live;
+	static unsigned int s_peak;
+	static unsigned int s_resets;
+};
+
+#endif /* CALLBACKPOOL_H_ */
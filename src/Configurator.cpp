@@ -18,10 +18,13 @@
 
 #include "BusClient.h"
 #include "Configurator.h"
+#include "CallbackPool.h"
+#include "EventRing.h"
 #include "dirent.h"
 #include <fstream>
 #include <streambuf>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <utime.h>
 #include <algorithm>
@@ -45,13 +48,16 @@ static std::string Replace(std::string input, const std::string& substr, const s
 
 
 ConfiguratorCallback::ConfiguratorCallback(Configurator* configurator, const std::string& filePath)
-	: m_slot(this, &ConfiguratorCallback::ResponseWrapper),
-	  m_config(filePath),
+	: m_config(filePath),
 	  m_handler(configurator),
 	  m_delegateInvoked(false),
 	  m_unconfigure(false),
 	  m_configure(false),
-      m_defaultCacheBehaviourUsed(false)
+      m_defaultCacheBehaviourUsed(false),
+	  m_attempts(0),
+	  m_timer(0),
+	  m_sentAt(0),
+	  m_traceId(0)
 {
 	assert(m_handler.get() != NULL);
 }
@@ -60,13 +66,149 @@ ConfiguratorCallback::~ConfiguratorCallback()
 {
 }
 
+void* ConfiguratorCallback::operator new(size_t size)
+{
+	return CallbackPool::Allocate(size);
+}
+
+void ConfiguratorCallback::operator delete(void* block, size_t size)
+{
+	CallbackPool::Release(block, size);
+}
+
+MojErr ConfiguratorCallback::Send(const char* service, const char* method, const MojObject& payload, const char* forgedAppId)
+{
+	m_service = service;
+	m_method = method;
+	m_payload = payload;
+	if (forgedAppId)
+		m_forgedAppId = forgedAppId;
+
+	return Dispatch();
+}
+
+MojErr ConfiguratorCallback::Dispatch()
+{
+	BusClient& busClient = m_handler->m_busClient;
+
+	MojErr err = busClient.Send(this, m_service.c_str(), m_method.c_str(), m_payload, m_forgedAppId.c_str());
+	MojErrCheck(err);
+
+	if (m_attempts == 0) {
+		m_sentAt = g_get_monotonic_time();
+		busClient.Stats().Sent(m_handler->ConfiguratorName(), m_service);
+		EventRing::Record(EventRing::Sent, m_handler->ConfiguratorName(), m_config);
+		busClient.Costs().Requested(m_handler->Owner(m_config));
+
+		// payload schemas are strict - the trace id goes into the log instead
+		if (busClient.Trace().Enabled()) {
+			m_traceId = busClient.Trace().BeginAsync(m_method.c_str(), m_service.c_str(), m_config);
+			LOG_INFO(MSGID_TRACE, 4,
+					PMLOGKFV("traceId", "%u", m_traceId),
+					PMLOGKS("service", m_service.c_str()),
+					PMLOGKS("method", m_method.c_str()),
+					PMLOGKS("config", m_config.c_str()),
+					"trace %u: %s/%s for %s", m_traceId, m_service.c_str(), m_method.c_str(), m_config.c_str());
+		}
+	} else {
+		busClient.Stats().Retried(m_handler->ConfiguratorName(), m_service);
+		EventRing::Record(EventRing::Retried, m_handler->ConfiguratorName(), m_config, m_attempts);
+	}
+	m_attempts++;
+	ArmTimer(busClient.Policy(m_service).timeout, &ConfiguratorCallback::TimeoutCallback);
+	return MojErrNone;
+}
+
+void ConfiguratorCallback::ArmTimer(unsigned int timeout, GSourceFunc callback)
+{
+	CancelTimer();
+
+	// the timer keeps us alive - the reply slot lets go of us once cancelled
+	m_timer = g_timeout_add_full(G_PRIORITY_DEFAULT, timeout, callback,
+			new MojRefCountedPtr<ConfiguratorCallback>(this), &ConfiguratorCallback::ReleaseCallback);
+}
+
+void ConfiguratorCallback::CancelTimer()
+{
+	if (m_timer != 0) {
+		unsigned int timer = m_timer;
+		m_timer = 0;
+		g_source_remove(timer);
+	}
+}
+
+void ConfiguratorCallback::ReleaseCallback(gpointer data)
+{
+	delete static_cast<MojRefCountedPtr<ConfiguratorCallback>*>(data);
+}
+
+gboolean ConfiguratorCallback::TimeoutCallback(gpointer data)
+{
+	ConfiguratorCallback* callback = static_cast<MojRefCountedPtr<ConfiguratorCallback>*>(data)->get();
+	callback->m_timer = 0;
+	callback->Expired();
+	return false;
+}
+
+gboolean ConfiguratorCallback::RetryCallback(gpointer data)
+{
+	ConfiguratorCallback* callback = static_cast<MojRefCountedPtr<ConfiguratorCallback>*>(data)->get();
+	callback->m_timer = 0;
+
+	MojErr err = callback->Dispatch();
+	if (err) {
+		MojObject response(MojObject::TypeObject);
+		response.putBool("returnValue", false);
+		response.putInt("errorCode", err);
+		response.putString("errorText", "Failed to re-send request");
+		callback->ResponseWrapper(response, err);
+	}
+	return false;
+}
+
+void ConfiguratorCallback::Expired()
+{
+	const BusClient::ServicePolicy& policy = m_handler->m_busClient.Policy(m_service);
+
+	Cancel();
+
+	if (m_attempts <= policy.retries) {
+		// exponential backoff with jitter so that retries to a struggling
+		// service from many configurators don't all land at once
+		unsigned int backoff = policy.backoff << (m_attempts - 1);
+		backoff += g_random_int_range(0, policy.backoff + 1);
+
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 3,
+				PMLOGKS("config", m_config.c_str()),
+				PMLOGKS("service", m_service.c_str()),
+				PMLOGKFV("attempt", "%u", m_attempts),
+				"%s/%s for %s timed out - retrying in %u ms", m_service.c_str(), m_method.c_str(), m_config.c_str(), backoff);
+		ArmTimer(backoff, &ConfiguratorCallback::RetryCallback);
+		return;
+	}
+
+	LOG_ERROR(MSGID_CONFIGURATOR_ERROR, 3,
+			PMLOGKS("config", m_config.c_str()),
+			PMLOGKS("service", m_service.c_str()),
+			PMLOGKFV("attempts", "%u", m_attempts),
+			"%s/%s for %s timed out after %u attempts", m_service.c_str(), m_method.c_str(), m_config.c_str(), m_attempts);
+
+	EventRing::Record(EventRing::TimedOut, m_handler->ConfiguratorName(), m_config, m_attempts);
+
+	MojObject response(MojObject::TypeObject);
+	response.putBool("returnValue", false);
+	response.putInt("errorCode", MojErrTimedOut);
+	response.putString("errorText", "Request timed out");
+	ResponseWrapper(response, MojErrTimedOut);
+}
+
 MojErr ConfiguratorCallback::DelegateResponse(MojObject& response, MojErr err)
 {
 	if (m_delegateInvoked)
 		return MojErrAccessDenied;
 	m_delegateInvoked = true;
 	m_defaultCacheBehaviourUsed = false;
-	return m_handler->BusResponseAsync(m_config, response, err, &m_defaultCacheBehaviourUsed);
+	return m_handler->BusResponseAsync(m_config, response, err, m_sentAt, &m_defaultCacheBehaviourUsed);
 }
 
 void ConfiguratorCallback::MarkConfigured()
@@ -81,11 +223,47 @@ void ConfiguratorCallback::UnmarkConfigured()
 	m_unconfigure = true;
 }
 
+// only count failures that say nothing about the config itself -
+// a service that rejects a config is still up, so a failure counts only
+// while the bus reports the service as not registered
+static bool serviceUnavailable(const BusClient& busClient, const std::string& service, const MojObject& response, MojErr err)
+{
+	if (err == MojErrTimedOut)
+		return true;
+
+	bool success = true;
+	response.get("returnValue", success);
+	if (!err && success)
+		return false;
+
+	return !busClient.ServiceConnected(service);
+}
+
+MojErr ConfiguratorCallback::HandleReply(MojObject &response, MojErr err)
+{
+	return ResponseWrapper(response, err);
+}
+
 MojErr ConfiguratorCallback::ResponseWrapper(MojObject &response, MojErr err)
 {
+	// cancelling the timer & slot can drop the last references to us
+	MojRefCountedPtr<ConfiguratorCallback> self(this);
+	TraceSpan span(m_handler->m_busClient.Trace(), "reply", m_handler->ConfiguratorName(), m_config);
 	MojErr result = MojErrNone;
 	try {
-		m_slot.cancel();
+		CancelTimer();
+		Cancel();
+		m_handler->m_busClient.RecordResult(m_service, serviceUnavailable(m_handler->m_busClient, m_service, response, err));
+
+		if (m_attempts > 0) {
+			bool success = true;
+			response.get("returnValue", success);
+			m_handler->m_busClient.Stats().Replied(m_handler->ConfiguratorName(), m_service, m_method,
+					!err && success, g_get_monotonic_time() - m_sentAt);
+			m_handler->m_busClient.Trace().EndAsync(m_method.c_str(), m_service.c_str(), m_traceId, !err && success);
+			EventRing::Record(EventRing::Replied, m_handler->ConfiguratorName(), m_config, err ? err : (success ? 0 : -1));
+			m_handler->m_busClient.Costs().Replied(m_handler->Owner(m_config), g_get_monotonic_time() - m_sentAt);
+		}
 		result = Response(response, err);
 	}  catch (const std::exception& e){
 		MojErrThrowMsg(MojErrInternal, "%s", e.what());
@@ -123,23 +301,42 @@ MojErr DefaultConfiguratorCallback::Response(MojObject &response, MojErr err)
 	return MojErrNone;
 }
 
-Configurator::ConfigCollection Configurator::m_configureOk;
-Configurator::ConfigCollection Configurator::m_configureFailed;
+Configurator::ClaimMap Configurator::m_claims[Configurator::PriorityCount];
+ResultLedger Configurator::m_ledger[Configurator::PriorityCount];
+std::string Configurator::m_cacheDir = kCacheDir;
+std::string Configurator::m_confCacheDir = kConfCacheDir;
+const unsigned int Configurator::MAX_FAILURES_PER_STEP = 8;
+const size_t Configurator::READAHEAD_BATCH = 16;
+
+void Configurator::ResetConfigStats(Priority priority)
+{
+	m_ledger[priority].Clear();
+}
+
+void Configurator::ReleaseClaims(Priority priority)
+{
+	m_claims[priority].clear();
+}
+
+const ResultLedger& Configurator::Ledger(Priority priority)
+{
+	return m_ledger[priority];
+}
 
-void Configurator::ResetConfigStats()
+void Configurator::SetRootDir(const std::string& root)
 {
-	m_configureOk.clear();
-	m_configureFailed.clear();
+	m_cacheDir = root + kCacheDir;
+	m_confCacheDir = root + kConfCacheDir;
 }
 
-const Configurator::ConfigCollection& Configurator::ConfigureOk()
+const std::string& Configurator::CacheDir()
 {
-	return m_configureOk;
+	return m_cacheDir;
 }
 
-const Configurator::ConfigCollection& Configurator::ConfigureFailure()
+const std::string& Configurator::ConfCacheDir()
 {
-	return m_configureFailed;
+	return m_confCacheDir;
 }
 
 Configurator::Configurator(const string& id, ConfigType confType, RunType type, BusClient& busClient, const string& configDirectory)
@@ -147,10 +344,16 @@ Configurator::Configurator(const string& id, ConfigType confType, RunType type,
   m_id(id),
 	m_confType(confType),
   m_currentType(type),
-  m_completed(false),
 	m_configDir(configDirectory),
-	m_scanned(false),
-    m_emptyConfigurator(false)
+    m_emptyConfigurator(false),
+	m_state(Scanning),
+	m_prefetched(0),
+	m_listOnly(false),
+	m_sendDeferred(false),
+	m_heldBack(false),
+	m_heldForLaterRun(false),
+	m_countsForReadiness(true),
+	m_priority(Bulk)
 {
 	InitCacheDir();
 }
@@ -167,8 +370,8 @@ ConfiguratorCallback* Configurator::CreateCallback(const std::string &filePath)
 
 void Configurator::InitCacheDir() const
 {
-	MojMkDir(kCacheDir, kCacheDirPerms);
-	MojMkDir(kConfCacheDir, kCacheStampPerm);
+	MojMkDir(m_cacheDir.c_str(), kCacheDirPerms);
+	MojMkDir(m_confCacheDir.c_str(), kCacheStampPerm);
 }
 
 bool Configurator::IsAlreadyConfigured(const std::string& confFile) const
@@ -178,7 +381,7 @@ bool Configurator::IsAlreadyConfigured(const std::string& confFile) const
 		return false;
 	}
 
-	std::string stamp = kConfCacheDir + Replace(confFile, "/", "_");
+	std::string stamp = StampPath(confFile);
 	MojStatT stampInfo, confInfo;
 
 	if (MojErrNone != MojStat(stamp.c_str(), &stampInfo))
@@ -227,7 +430,7 @@ void Configurator::MarkConfigured(const std::string &confFile) const
 		times = NULL;
 	}
 
-	string stamp = kConfCacheDir + Replace(confFile, "/", "_");
+	string stamp = StampPath(confFile);
 
 	int stampFd = open(stamp.c_str(), O_CREAT | O_WRONLY | O_NOATIME, kCacheStampPerm);
 	if (stampFd == -1) {
@@ -266,7 +469,7 @@ void Configurator::MarkConfigured(const std::string &confFile) const
 		times = NULL;
 	}
 
-	string stamp = kConfCacheDir + Replace(confFile, "/", "_");
+	string stamp = StampPath(confFile);
 
 	int stampFd = open(stamp.c_str(), O_CREAT | O_WRONLY | O_NOATIME, kCacheStampPerm);
 	if (stampFd == -1) {
@@ -297,7 +500,7 @@ void Configurator::UnmarkConfigured(const std::string &confFile) const
 	if (!CanCacheConfiguratorStatus(confFile))
 		return;
 
-	string stamp = kConfCacheDir + Replace(confFile, "/", "_");
+	string stamp = StampPath(confFile);
 	if (unlink(stamp.c_str()) == 0)
     {
 		LOG_DEBUG("removed configured stamp for '%s'", confFile.c_str());
@@ -311,12 +514,58 @@ void Configurator::UnmarkConfigured(const std::string &confFile) const
     }
 }
 
+const std::string& Configurator::Id() const
+{
+	return m_id;
+}
+
+bool Configurator::Scanned() const
+{
+	return m_state != Scanning;
+}
+
+void Configurator::SetPriority(Priority priority)
+{
+	m_priority = priority;
+}
+
+Configurator::Priority Configurator::GetPriority() const
+{
+	return m_priority;
+}
+
+std::string Configurator::Owner(const std::string& filePath) const
+{
+	const std::string& owner = ParentId(filePath);
+	if (!owner.empty())
+		return owner;
+	return filePath.substr(filePath.rfind('/') + 1);
+}
+
+std::string Configurator::StampPath(const std::string& confFile) const
+{
+	return m_confCacheDir + Replace(confFile, "/", "_");
+}
+
+std::string Configurator::StampPath(const std::string& confFile, const std::string& subdir) const
+{
+	return m_confCacheDir + subdir + "/" + Replace(confFile, "/", "_");
+}
+
 const std::string& Configurator::ParentId(const std::string& filePath) const
 {
-	ConfigMap::const_iterator i = m_parentDirMap.find(filePath);
-	if (i == m_parentDirMap.end() || i->second.empty())
+	PathTable::PathId config = PathTable::Find(filePath);
+	if (config == PathTable::InvalidPath)
+		return m_id;
+	return ParentId(config);
+}
+
+const std::string& Configurator::ParentId(PathTable::PathId config) const
+{
+	// configs directly in the configurator's directory belong to no package
+	if (PathTable::Directory(config) == m_configDir)
 		return m_id;
-	return i->second;
+	return PathTable::DirectoryName(config);
 }
 
 bool Configurator::CanCacheConfiguratorStatus(const std::string &) const
@@ -325,40 +574,131 @@ bool Configurator::CanCacheConfiguratorStatus(const std::string &) const
 	return true;
 }
 
+bool Configurator::ReadyToProcess()
+{
+	return true;
+}
+
+MojErr Configurator::SendRequest(ConfiguratorCallback* callback, const char* method, const MojObject& payload, const char* forgedAppId)
+{
+	if (!m_busClient.AllowRequest(ServiceName())) {
+		// nobody else will hold on to the callback
+		MojRefCountedPtr<ConfiguratorCallback> discarded(callback);
+
+		LOG_DEBUG("%s is unavailable - deferring %s request", ServiceName(), method);
+		m_busClient.Stats().Deferred(ConfiguratorName(), ServiceName());
+		m_sendDeferred = true;
+		return MojErrInProgress;
+	}
+
+	MojErr err = callback->Send(ServiceName(), method, payload, forgedAppId);
+	if (err)
+		m_busClient.RecordResult(ServiceName(), true);
+	return err;
+}
+
+void Configurator::HoldBack(bool laterRun)
+{
+	m_heldBack = true;
+	m_heldForLaterRun = laterRun;
+}
+
 bool Configurator::Run()
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
-	if (!m_scanned) {
-        bool folderFound = GetConfigFiles("", m_configDir);
-		if (m_configs.empty()) {
-            if (folderFound) // Prevents double logging when folder is missing
-                LOG_DEBUG("No configurations found in %s", m_configDir.c_str());
-			m_emptyConfigurator = true;
-		} else {
-			m_emptyConfigurator = false;
+	// Each call is one step: the scan, or sending a config.  Configs that fail
+	// without a request going out don't end the step, up to
+	// MAX_FAILURES_PER_STEP of them - after that the rest waits for the next tick.
+	unsigned int failures = 0;
+	for (;;) {
+		switch (m_state) {
+		case Scanning: {
+			TraceSpan span(m_busClient.Trace(), "scan", ConfiguratorName(), m_configDir);
+			std::vector<FoundConfig> found;
+			bool folderFound = m_listOnly ? GetListedFiles(found) : GetConfigFiles("", m_configDir, found);
+			OrderConfigs(found);
+			if (m_configs.empty() && folderFound) // Prevents double logging when folder is missing
+				LOG_DEBUG("No configurations found in %s", m_configDir.c_str());
+			m_emptyConfigurator = m_configs.empty();
+			m_state = Sending;
+			break;
 		}
-		m_scanned = true;
-	}
 
-	if (m_configs.empty()) {
-		if (m_pendingConfigs.empty() && !m_completed) {
+		case Sending: {
+			if (m_configs.empty()) {
+				m_state = Draining;
+				break;
+			}
+
+			// held until the target service has registered - configurators for
+			// services that are already up carry on in the meantime
+			if (!m_busClient.ServiceReady(ServiceName()) || !ReadyToProcess()) {
+				LOG_DEBUG("%s :: waiting on %s before configuring", ConfiguratorName(), ServiceName());
+				return true;
+			}
+
+			if (m_prefetched == 0)
+				Prefetch();
+			PathTable::PathId config = m_configs.back();
+			m_configs.pop_back();
+			m_prefetched--;
+
+			if (ProcessFile(config, PathTable::Path(config)) == MojErrNone)
+				return m_configs.empty();
+			if (++failures >= MAX_FAILURES_PER_STEP && !m_configs.empty())
+				return false;
+			break;
+		}
+
+		case Draining:
+			// nothing to do - already sent out all the requests
+			// just waiting for responses from services
+			if (!m_pendingConfigs.empty()) {
+				LOG_DEBUG("%s :: %zd configurations pending", ConfiguratorName(), m_pendingConfigs.size());
+				return true;
+			}
 			if (!m_emptyConfigurator) {
 				LOG_DEBUG("%s :: No more configurations", ConfiguratorName());
 			}
+			m_state = Done;
 			Complete();
-		} else {
-			LOG_DEBUG("%s :: %d configurations pending, m_completed = %d", ConfiguratorName(), m_pendingConfigs.size(), m_completed);
+			return true;
+
+		case Done:
+			return true;
 		}
-		// nothing to do - already sent out all the requests
-		// just waiting for responses from services
-		return m_configs.empty();
 	}
-	// Read the config file
-	string filePath = m_configs.back();
-	m_configs.pop_back();
-	m_pendingConfigs.push_back(filePath);
-	string config = ReadFile(filePath);
+}
+
+MojErr Configurator::SendDeferred(const std::string& filePath)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	return ProcessFile(filePath);
+}
+
+MojErr Configurator::ProcessFile(const std::string& filePath)
+{
+	return ProcessFile(PathTable::Intern(filePath), filePath);
+}
+
+MojErr Configurator::ProcessFile(PathTable::PathId id, const std::string& filePath)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	TraceSpan span(m_busClient.Trace(), "process", ConfiguratorName(), filePath);
+
+	m_pendingConfigs.push_back(id);
+	m_sendDeferred = false;
+	m_heldBack = false;
+	m_heldForLaterRun = false;
+	string config;
+	{
+		TraceSpan readSpan(m_busClient.Trace(), "read", ConfiguratorName(), filePath);
+		config = ReadFile(filePath);
+	}
+	m_busClient.Costs().Read(Owner(filePath), config.size());
 
 	LOG_DEBUG("%s :: Configuring '%s'", ConfiguratorName(), filePath.c_str());
 
@@ -375,8 +715,14 @@ bool Configurator::Run()
 	}
 
 	if (err) {
-		if (MojErrInProgress == err) {
-			m_configureOk.push_back(config);
+		if (m_sendDeferred || m_heldBack) {
+			// not stamped - picked up again later
+			if (m_sendDeferred)
+				m_busClient.DeferSend(this, ServiceName(), filePath);
+			EventRing::Record(EventRing::Deferred, ConfiguratorName(), filePath);
+			RecordResult(id, ResultLedger::Deferred);
+		} else if (MojErrInProgress == err) {
+			RecordResult(id, ResultLedger::Ok);
 			LOG_DEBUG("Skipping config file: %s", filePath.c_str());
 		}
 		else
@@ -389,18 +735,24 @@ bool Configurator::Run()
 					"Failed to process config: %s (error: %s)", config.c_str(), errorMsg.data());
 	
 			// Skip this file and keep going!
-			m_configureFailed.push_back(filePath);
+			EventRing::Record(EventRing::Failed, ConfiguratorName(), filePath, err);
+			RecordResult(id, ResultLedger::Failed, err);
 		}
 		m_pendingConfigs.pop_back();
-		return Run();
 	}
-	return m_configs.empty();
+	return err;
 }
 
 MojErr Configurator::ProcessConfig(const std::string &filePath, const std::string &json)
 {
 	MojObject parsed;
-	MojErr err = parsed.fromJson(json.c_str());
+	MojErr err;
+	{
+		TraceSpan span(m_busClient.Trace(), "parse", ConfiguratorName(), filePath);
+		gint64 start = g_get_monotonic_time();
+		err = parsed.fromJson(json.c_str());
+		m_busClient.Costs().Parsed(Owner(filePath), g_get_monotonic_time() - start);
+	}
 	MojErrCheck(err);
 
 	return ProcessConfig(filePath, parsed);
@@ -409,14 +761,136 @@ MojErr Configurator::ProcessConfig(const std::string &filePath, const std::strin
 MojErr Configurator::ProcessConfigRemoval(const std::string &filePath, const std::string &json)
 {
 	MojObject parsed;
-	MojErr err = parsed.fromJson(json.c_str());
+	MojErr err;
+	{
+		TraceSpan span(m_busClient.Trace(), "parse", ConfiguratorName(), filePath);
+		gint64 start = g_get_monotonic_time();
+		err = parsed.fromJson(json.c_str());
+		m_busClient.Costs().Parsed(Owner(filePath), g_get_monotonic_time() - start);
+	}
 	MojErrCheck(err);
 
 	return ProcessConfigRemoval(filePath, parsed);
 }
 
+bool Configurator::FoundConfig::operator<(const FoundConfig& other) const
+{
+	if (device != other.device)
+		return device < other.device;
+	return inode < other.inode;
+}
+
+// Configs are sent in inode order: on a cold cache the reads then follow the
+// on-disk layout far more closely than readdir order does, and the order is
+// the same on every boot of the same image.
+void Configurator::OrderConfigs(std::vector<FoundConfig>& found)
+{
+	// m_configs is consumed from the back
+	std::sort(found.rbegin(), found.rend());
+	m_configs.reserve(m_configs.size() + found.size());
+	for (std::vector<FoundConfig>::const_iterator i = found.begin(); i != found.end(); ++i)
+		m_configs.push_back(i->id);
+}
+
+// asks the kernel to start reading the next READAHEAD_BATCH configs, so that
+// they are queued together rather than one at a time
+void Configurator::Prefetch()
+{
+	size_t count = std::min(m_configs.size(), READAHEAD_BATCH);
+	for (size_t i = 0; i < count; i++) {
+		int fd = open(PathTable::Path(m_configs[m_configs.size() - 1 - i]).c_str(), O_RDONLY);
+		if (fd < 0)
+			continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+	m_prefetched = count;
+}
+
+bool Configurator::FileKey::operator<(const FileKey& other) const
+{
+	if (device != other.device)
+		return device < other.device;
+	if (inode != other.inode)
+		return inode < other.inode;
+	return type < other.type;
+}
+
+// whether realpath() leaves filePath as it is - i.e. no symlink on the way
+static bool resolvesToItself(const std::string& filePath)
+{
+	char* resolved = realpath(filePath.c_str(), NULL);
+	bool same = resolved != NULL && filePath == resolved;
+	free(resolved);
+	return same;
+}
+
+// the canonical one of two paths to the same file: the one that resolves to
+// itself, or else the lower one - so that it doesn't depend on the walk order
+static bool preferredPath(const std::string& path, const std::string& other)
+{
+	bool resolved = resolvesToItself(path);
+	if (resolved != resolvesToItself(other))
+		return resolved;
+	return path < other;
+}
+
+bool Configurator::Claim(const struct stat& file, PathTable::PathId id, std::vector<FoundConfig>& found, PathTable::PathId& other)
+{
+	FileKey key = { file.st_dev, file.st_ino, m_currentType };
+	Claimant claimant = { id, this };
+	std::pair<ClaimMap::iterator, bool> claim = m_claims[m_priority].insert(ClaimMap::value_type(key, claimant));
+	other = PathTable::InvalidPath;
+	if (claim.second)
+		return true;
+
+	// only duplicates pay for resolving the paths
+	Claimant& previous = claim.first->second;
+	other = previous.id;
+	if (!preferredPath(PathTable::Path(id), PathTable::Path(other)))
+		return false;
+
+	// too late once the other path has been sent (or was stamped already)
+	if (!previous.configurator->Withdraw(other, previous.configurator == this ? &found : NULL))
+		return false;
+
+	previous = claimant;
+	return true;
+}
+
+bool Configurator::Withdraw(PathTable::PathId id, std::vector<FoundConfig>* found)
+{
+	bool withdrawn = false;
+	if (found) {
+		for (std::vector<FoundConfig>::iterator i = found->begin(); i != found->end(); ++i) {
+			if (i->id == id) {
+				found->erase(i);
+				withdrawn = true;
+				break;
+			}
+		}
+	} else {
+		ConfigCollection::iterator i = std::find(m_configs.begin(), m_configs.end(), id);
+		if (i != m_configs.end()) {
+			// the prefetched ones are at the back
+			if ((size_t)(m_configs.end() - i) <= m_prefetched)
+				m_prefetched--;
+			m_configs.erase(i);
+			withdrawn = true;
+		}
+	}
+
+	if (!withdrawn)
+		return false;
+
+	// charged to the owner of the canonical path only - balances the scan's Expect
+	if (CountsForReadiness())
+		m_busClient.Readiness().Succeeded(ParentId(id));
+	return true;
+}
+
 // returns whether folder exists or not
-bool Configurator::GetConfigFiles(const string& parent, const string& directory)
+bool Configurator::GetConfigFiles(const string& parent, const string& directory, std::vector<FoundConfig>& found)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
@@ -442,18 +916,9 @@ bool Configurator::GetConfigFiles(const string& parent, const string& directory)
 			filePath.append(filename);
 			if(0 == stat(filePath.c_str(), &stat_buf)) {
 				if (S_ISDIR(stat_buf.st_mode)) {
-					GetConfigFiles(filename, filePath);
+					GetConfigFiles(filename, filePath, found);
 				} else {
-					if (! parent.empty())
-						m_parentDirMap[filePath] = parent;
-
-					// Check if the config file has already been processed
-					if (!(m_currentType == Configure && IsAlreadyConfigured(filePath))) {
-						LOG_DEBUG("Found configuration '%s'", filePath.c_str());
-						m_configs.push_back(filePath);
-					} else {
-						LOG_DEBUG("Skipping configuration '%s' because it has already run (cache stamp in %s exists)", filePath.c_str(), kConfCacheDir);
-					}
+					AddFound(PathTable::Intern(directory, filename), filePath, stat_buf, found);
 				}
 			}
 			else {
@@ -466,6 +931,75 @@ bool Configurator::GetConfigFiles(const string& parent, const string& directory)
     return true;
 }
 
+// the scan's bookkeeping for a config file - it is added to found unless it
+// is a duplicate or already stamped
+void Configurator::AddFound(PathTable::PathId id, const std::string& filePath, const struct stat& file, std::vector<FoundConfig>& found)
+{
+	PathTable::PathId other;
+	if (!Claim(file, id, found, other)) {
+		// charged to the owner of the canonical path only
+		m_busClient.Stats().Duplicate(ConfiguratorName());
+		EventRing::Record(EventRing::Skipped, ConfiguratorName(), filePath);
+		LOG_DEBUG("Skipping '%s' - same file as '%s' (%s)", filePath.c_str(),
+				PathTable::Path(other).c_str(), Owner(PathTable::Path(other)).c_str());
+		return;
+	}
+	if (other != PathTable::InvalidPath) {
+		m_busClient.Stats().Duplicate(ConfiguratorName());
+		EventRing::Record(EventRing::Skipped, ConfiguratorName(), PathTable::Path(other));
+		LOG_DEBUG("Skipping '%s' - same file as '%s' (%s)", PathTable::Path(other).c_str(),
+				filePath.c_str(), Owner(filePath).c_str());
+	}
+
+	const std::string& owner = ParentId(id);
+	if (CountsForReadiness())
+		m_busClient.Readiness().Expect(owner);
+
+	m_busClient.Stats().Scanned(ConfiguratorName());
+	EventRing::Record(EventRing::Scanned, ConfiguratorName(), filePath);
+
+	// Check if the config file has already been processed
+	if (!(m_currentType == Configure && IsAlreadyConfigured(filePath))) {
+		LOG_DEBUG("Found configuration '%s'", filePath.c_str());
+		FoundConfig config = { file.st_dev, file.st_ino, id };
+		found.push_back(config);
+	} else {
+		m_busClient.Stats().Skipped(ConfiguratorName());
+		if (CountsForReadiness())
+			m_busClient.Readiness().Succeeded(owner);
+		EventRing::Record(EventRing::Skipped, ConfiguratorName(), filePath);
+		LOG_DEBUG("Skipping configuration '%s' because it has already run (cache stamp in %s exists)", filePath.c_str(), m_confCacheDir.c_str());
+	}
+}
+
+// the configs given through AddConfig, instead of the directory walk
+bool Configurator::GetListedFiles(std::vector<FoundConfig>& found)
+{
+	struct stat stat_buf;
+	for (std::vector<std::string>::const_iterator i = m_listed.begin(); i != m_listed.end(); ++i) {
+		if (stat(i->c_str(), &stat_buf) != 0 || S_ISDIR(stat_buf.st_mode)) {
+			LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+					PMLOGKS("file", i->c_str()),
+					"Listed configuration %s is not a file", i->c_str());
+			continue;
+		}
+		AddFound(PathTable::Intern(*i), *i, stat_buf, found);
+	}
+	m_listed.clear();
+	return true;
+}
+
+void Configurator::AddConfig(const std::string& filePath)
+{
+	m_listed.push_back(filePath);
+	m_listOnly = true;
+}
+
+const std::string& Configurator::ConfigDir() const
+{
+	return m_configDir;
+}
+
 const string Configurator::ReadFile(const string& filePath)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
@@ -494,16 +1028,60 @@ const string Configurator::ReadFile(const string& filePath)
 void Configurator::Complete()
 {
 	m_busClient.ConfiguratorComplete(this);
-	m_completed = true;
 }
 
-MojErr Configurator::BusResponseAsync(const std::string& config, MojObject& response, MojErr err, bool *cacheConfigured)
+bool Configurator::RecordsResult(PathTable::PathId) const
+{
+	return true;
+}
+
+bool Configurator::CountsForReadiness() const
+{
+	return m_countsForReadiness && m_currentType != RemoveConfiguration;
+}
+
+void Configurator::ExcludeFromReadiness()
+{
+	m_countsForReadiness = false;
+}
+
+void Configurator::RecordResult(PathTable::PathId id, ResultLedger::Status status, MojErr err, gint64 latency)
+{
+	if (!RecordsResult(id))
+		return;
+
+	m_ledger[m_priority].Add(id, ConfiguratorName(), status, err, latency);
+
+	if (!CountsForReadiness())
+		return;
+
+	switch (status) {
+	case ResultLedger::Ok:
+		m_busClient.Readiness().Succeeded(ParentId(id));
+		break;
+	case ResultLedger::Failed:
+		m_busClient.Readiness().Failed(ParentId(id));
+		break;
+	default:
+		// held for a later run (breaker, first use) - the owner can't become
+		// configured in this one.  An update applied later in this process is
+		// counted by the owner's outstanding deferred kinds instead.
+		if (m_sendDeferred || m_heldForLaterRun)
+			m_busClient.Readiness().Held(ParentId(id));
+		else
+			m_busClient.Readiness().Succeeded(ParentId(id));
+		break;
+	}
+}
+
+MojErr Configurator::BusResponseAsync(const std::string& config, MojObject& response, MojErr err, gint64 sentAt, bool *cacheConfigured)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
 
 	try {
 		// remove the config from the list
-		ConfigCollection::iterator i = find(m_pendingConfigs.begin(), m_pendingConfigs.end(), config);
+		PathTable::PathId id = PathTable::Intern(config);
+		ConfigCollection::iterator i = find(m_pendingConfigs.begin(), m_pendingConfigs.end(), id);
 		if (i == m_pendingConfigs.end()) {
 			LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
 					PMLOGKS("for", config.c_str()),
@@ -515,9 +1093,13 @@ MojErr Configurator::BusResponseAsync(const std::string& config, MojObject& resp
 
 		bool success = true;
 		response.get("returnValue", success);
+		gint64 latency = sentAt ? g_get_monotonic_time() - sentAt : 0;
 
 		if (err || !success) {
-			m_configureFailed.push_back(config);
+			MojInt64 errorCode = err;
+			if (!err)
+				response.get("errorCode", errorCode);
+			RecordResult(id, ResultLedger::Failed, (MojErr) errorCode, latency);
 
 			MojString json;
 			MojErrCheck(response.toJson(json));
@@ -527,7 +1109,7 @@ MojErr Configurator::BusResponseAsync(const std::string& config, MojObject& resp
 					PMLOGKFV("error", "%d", err),
 					"%s: %s (MojErr: %i)", config.c_str(), json.data(), err);
 		} else {
-			m_configureOk.push_back(config);
+			RecordResult(id, ResultLedger::Ok, MojErrNone, latency);
 
 			*cacheConfigured = true;
 			if (m_currentType != RemoveConfiguration)
@@ -536,8 +1118,9 @@ MojErr Configurator::BusResponseAsync(const std::string& config, MojObject& resp
 				UnmarkConfigured(config);
 		}
 
-		// do the next config
-		Run();
+		// the next config (or the completion) is a step of its own - not run
+		// from within the reply
+		m_busClient.RunNextConfigurator();
 	} catch (const std::exception& e){
 		MojErrThrowMsg(MojErrInternal, "%s", e.what());
 	} catch (...) {
@@ -0,0 +1,202 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "ConfiguratorStats.h"
+
+ConfiguratorStats::Counters::Counters()
+	: scanned(0),
+	  skipped(0),
+	  duplicates(0),
+	  sent(0),
+	  succeeded(0),
+	  failed(0),
+	  inFlight(0),
+	  retried(0),
+	  deferred(0)
+{
+}
+
+MojErr ConfiguratorStats::Counters::ToJson(MojObject& counters) const
+{
+	MojErr err;
+
+	err = counters.putInt("scanned", scanned); MojErrCheck(err);
+	err = counters.putInt("skipped", skipped); MojErrCheck(err);
+	err = counters.putInt("duplicates", duplicates); MojErrCheck(err);
+	err = counters.putInt("sent", sent); MojErrCheck(err);
+	err = counters.putInt("succeeded", succeeded); MojErrCheck(err);
+	err = counters.putInt("failed", failed); MojErrCheck(err);
+	err = counters.putInt("inFlight", inFlight); MojErrCheck(err);
+	err = counters.putInt("retried", retried); MojErrCheck(err);
+	err = counters.putInt("deferred", deferred); MojErrCheck(err);
+	return MojErrNone;
+}
+
+ConfiguratorStats::Histogram::Histogram()
+	: count(0),
+	  totalUs(0),
+	  maxUs(0)
+{
+	for (unsigned int i = 0; i < BUCKETS; i++)
+		buckets[i] = 0;
+}
+
+void ConfiguratorStats::Histogram::Add(gint64 latencyUs)
+{
+	unsigned int bucket = 0;
+	gint64 ms = latencyUs / 1000;
+
+	while (bucket < BUCKETS - 1 && ms >= ((gint64)1 << bucket))
+		bucket++;
+
+	buckets[bucket]++;
+	count++;
+	totalUs += latencyUs;
+	if (latencyUs > maxUs)
+		maxUs = latencyUs;
+}
+
+MojErr ConfiguratorStats::Histogram::ToJson(MojObject& histogram) const
+{
+	MojErr err;
+
+	err = histogram.putInt("count", count); MojErrCheck(err);
+	err = histogram.putInt("meanMs", count ? totalUs / count / 1000 : 0); MojErrCheck(err);
+	err = histogram.putInt("maxMs", maxUs / 1000); MojErrCheck(err);
+
+	// {"<1": n, "<2": n, "<4": n, ... ">=65536": n} - empty buckets left out
+	MojObject bucketsJson(MojObject::TypeObject);
+	for (unsigned int i = 0; i < BUCKETS; i++) {
+		if (buckets[i] == 0)
+			continue;
+
+		MojString label;
+		if (i < BUCKETS - 1)
+			err = label.format("<%u", 1u << i);
+		else
+			err = label.format(">=%u", 1u << (i - 1));
+		MojErrCheck(err);
+
+		err = bucketsJson.putInt(label.data(), buckets[i]);
+		MojErrCheck(err);
+	}
+	return histogram.put("buckets", bucketsJson);
+}
+
+ConfiguratorStats::ConfiguratorStats()
+	: m_started(g_get_monotonic_time())
+{
+}
+
+void ConfiguratorStats::Scanned(const std::string& configurator)
+{
+	m_configurators[configurator].scanned++;
+}
+
+void ConfiguratorStats::Skipped(const std::string& configurator)
+{
+	m_configurators[configurator].skipped++;
+}
+
+void ConfiguratorStats::Duplicate(const std::string& configurator)
+{
+	m_configurators[configurator].duplicates++;
+}
+
+void ConfiguratorStats::Sent(const std::string& configurator, const std::string& service)
+{
+	Counters& c = m_configurators[configurator];
+	Counters& s = m_services[service];
+
+	c.sent++;
+	c.inFlight++;
+	s.sent++;
+	s.inFlight++;
+}
+
+void ConfiguratorStats::Retried(const std::string& configurator, const std::string& service)
+{
+	m_configurators[configurator].retried++;
+	m_services[service].retried++;
+}
+
+void ConfiguratorStats::Deferred(const std::string& configurator, const std::string& service)
+{
+	m_configurators[configurator].deferred++;
+	m_services[service].deferred++;
+}
+
+void ConfiguratorStats::Replied(const std::string& configurator, const std::string& service, const std::string& method, bool success, gint64 latencyUs)
+{
+	Counters* counters[] = { &m_configurators[configurator], &m_services[service] };
+
+	for (unsigned int i = 0; i < 2; i++) {
+		if (success)
+			counters[i]->succeeded++;
+		else
+			counters[i]->failed++;
+		if (counters[i]->inFlight > 0)
+			counters[i]->inFlight--;
+	}
+
+	m_methods[method].Add(latencyUs);
+}
+
+MojErr ConfiguratorStats::ToJson(const CounterMap& counters, MojObject& json)
+{
+	for (CounterMap::const_iterator i = counters.begin(); i != counters.end(); ++i) {
+		MojObject entry(MojObject::TypeObject);
+		MojErr err = i->second.ToJson(entry);
+		MojErrCheck(err);
+		err = json.put(i->first.c_str(), entry);
+		MojErrCheck(err);
+	}
+	return MojErrNone;
+}
+
+MojErr ConfiguratorStats::ToJson(MojObject& stats) const
+{
+	MojErr err;
+	gint64 uptimeMs = (g_get_monotonic_time() - m_started) / 1000;
+	unsigned int replies = 0;
+
+	MojObject configurators(MojObject::TypeObject);
+	err = ToJson(m_configurators, configurators);
+	MojErrCheck(err);
+
+	MojObject services(MojObject::TypeObject);
+	err = ToJson(m_services, services);
+	MojErrCheck(err);
+
+	MojObject methods(MojObject::TypeObject);
+	for (HistogramMap::const_iterator i = m_methods.begin(); i != m_methods.end(); ++i) {
+		MojObject histogram(MojObject::TypeObject);
+		err = i->second.ToJson(histogram);
+		MojErrCheck(err);
+		err = methods.put(i->first.c_str(), histogram);
+		MojErrCheck(err);
+		replies += i->second.count;
+	}
+
+	err = stats.putInt("uptimeMs", uptimeMs); MojErrCheck(err);
+	err = stats.putInt("repliesPerSecond", uptimeMs > 0 ? replies * 1000 / uptimeMs : 0); MojErrCheck(err);
+	err = stats.put("configurators", configurators); MojErrCheck(err);
+	err = stats.put("services", services); MojErrCheck(err);
+	err = stats.put("methods", methods); MojErrCheck(err);
+	return MojErrNone;
+}
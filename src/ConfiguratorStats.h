@@ -0,0 +1,91 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef CONFIGURATORSTATS_H_
+#define CONFIGURATORSTATS_H_
+
+#include "core/MojObject.h"
+#include <glib.h>
+#include <map>
+#include <string>
+
+/**
+ * Counters for a run of the configurator - per configurator, per target
+ * service & a reply latency histogram per service method.  Reported by the
+ * "stats" method & dumped to the log on SIGUSR1.
+ */
+class ConfiguratorStats
+{
+public:
+	ConfiguratorStats();
+
+	void Scanned(const std::string& configurator);
+	void Skipped(const std::string& configurator);
+	void Duplicate(const std::string& configurator);
+	void Sent(const std::string& configurator, const std::string& service);
+	void Retried(const std::string& configurator, const std::string& service);
+	void Deferred(const std::string& configurator, const std::string& service);
+	void Replied(const std::string& configurator, const std::string& service, const std::string& method, bool success, gint64 latencyUs);
+
+	MojErr ToJson(MojObject& stats) const;
+
+private:
+	struct Counters {
+		unsigned int scanned;
+		unsigned int skipped;   /// already stamped
+		unsigned int duplicates;/// same file as a config found under another path
+		unsigned int sent;
+		unsigned int succeeded;
+		unsigned int failed;
+		unsigned int inFlight;
+		unsigned int retried;
+		unsigned int deferred;  /// held back by the service's breaker
+
+		Counters();
+		MojErr ToJson(MojObject& counters) const;
+	};
+
+	/**
+	 * Reply latencies in power of 2 millisecond buckets - bucket i counts
+	 * replies that took less than 2^i ms, the last one everything slower.
+	 */
+	struct Histogram {
+		static const unsigned int BUCKETS = 18;
+
+		unsigned int count;
+		gint64 totalUs;
+		gint64 maxUs;
+		unsigned int buckets[BUCKETS];
+
+		Histogram();
+		void Add(gint64 latencyUs);
+		MojErr ToJson(MojObject& histogram) const;
+	};
+
+	typedef std::map<std::string, Counters> CounterMap;
+	typedef std::map<std::string, Histogram> HistogramMap;
+
+	static MojErr ToJson(const CounterMap& counters, MojObject& json);
+
+	gint64 m_started;
+	CounterMap m_configurators;
+	CounterMap m_services;
+	HistogramMap m_methods;
+};
+
+#endif /* CONFIGURATORSTATS_H_ */
@@ -20,6 +20,10 @@
 #include "DbKindConfigurator.h"
 #include "BusClient.h"
 
+#include <fstream>
+#include <map>
+#include <sstream>
+
 using namespace std;
 
 static const char *MOJODB_DB_BUS_ADDRESS = "com.palm.db";
@@ -27,6 +31,7 @@ static const char *MOJODB_TEMPDB_BUS_ADDRESS = "com.palm.tempdb";
 static const char *MOJODB_MEDIADB_BUS_ADDRESS = "com.webos.mediadb";
 static const char *MOJODB_PUTKIND_METHOD = "putKind";
 static const char *MOJODB_DELKIND_METHOD = "delKind";
+static const char *INDEX_RECORD_DIR = "indexes";
 
 const char* DbKindConfigurator::ConfiguratorName() const
 {
@@ -43,8 +48,11 @@ typedef MojServiceRequest::ReplySignal::Slot<Configurator> ReplySlot;
 class DbKindConfiguratorResponse : public ConfiguratorCallback
 {
 public:
-	DbKindConfiguratorResponse(Configurator *configurator, const std::string& configFile)
-		: ConfiguratorCallback(configurator, configFile)
+	DbKindConfiguratorResponse(DbKindConfigurator *configurator, const std::string& configFile, const std::string& indexes = std::string(), bool deferred = false)
+		: ConfiguratorCallback(configurator, configFile),
+		  m_kindConfigurator(configurator),
+		  m_indexes(indexes),
+		  m_deferred(deferred)
 	{
 	}
 
@@ -54,8 +62,37 @@ public:
 
 	MojErr Response(MojObject& response, MojErr err)
 	{
-		return MojErrNone;
+		bool success = true;
+		response.get("returnValue", success);
+
+		// remember which indexes db8 has now built so that the next update
+		// of this kind can be classified without asking db8
+		if (!err && success && m_kindConfigurator->CanCacheConfiguratorStatus(m_config)) {
+			if (m_kindConfigurator->m_currentType == Configurator::RemoveConfiguration)
+				unlink(m_kindConfigurator->StampPath(m_config, INDEX_RECORD_DIR).c_str());
+			else
+				m_kindConfigurator->SaveIndexRecord(m_config, m_indexes);
+		}
+
+		if (!m_deferred)
+			return MojErrNone;
+
+		// the default handling has to see it as a deferred apply still
+		MojErr result = DelegateResponse(response, err);
+		DbKindConfigurator::DeferredApplyMap::iterator apply =
+				m_kindConfigurator->m_deferredApplies.find(PathTable::Find(m_config));
+		if (apply != m_kindConfigurator->m_deferredApplies.end()) {
+			std::string owner = apply->second;
+			m_kindConfigurator->m_deferredApplies.erase(apply);
+			m_kindConfigurator->m_busClient.DeferredKindComplete(m_config, owner, !err && success);
+		}
+		return result;
 	}
+
+private:
+	DbKindConfigurator* m_kindConfigurator;
+	const std::string m_indexes;
+	const bool m_deferred;
 };
 
 DbKindConfigurator::DbKindConfigurator(const std::string& id, ConfigType confType, RunType type, BusClient& busClient, MojDbClient& dbClient, string configDirectory)
@@ -69,6 +106,96 @@ DbKindConfigurator::~DbKindConfigurator()
 
 }
 
+ConfiguratorCallback* DbKindConfigurator::CreateCallback(const std::string &filePath)
+{
+	return new DbKindConfiguratorResponse(this, filePath);
+}
+
+MojErr DbKindConfigurator::ApplyDeferred(const std::string& filePath, const std::string& owner)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	PathTable::PathId id = PathTable::Intern(filePath);
+	m_deferredApplies[id] = owner;
+	MojErr err = ProcessFile(filePath);
+
+	// MojErrInProgress - db8's breaker holds it & SendDeferred sends it later,
+	// still as a deferred apply
+	if (err != MojErrNone && err != MojErrInProgress)
+		m_deferredApplies.erase(id);
+	return err;
+}
+
+bool DbKindConfigurator::RecordsResult(PathTable::PathId config) const
+{
+	return m_deferredApplies.find(config) == m_deferredApplies.end();
+}
+
+// one line per index: "<name> <sha1 of the index definition>"
+MojErr DbKindConfigurator::IndexRecord(const MojObject& kind, std::string& record) const
+{
+	MojObject indexes;
+	record.clear();
+
+	if (!kind.get("indexes", indexes))
+		return MojErrNone;
+
+	for (MojObject::ConstArrayIterator i = indexes.arrayBegin(); i != NULL && i != indexes.arrayEnd(); ++i) {
+		MojString name;
+		MojString json;
+		MojErr err;
+
+		err = i->getRequired("name", name);
+		MojErrCheck(err);
+		err = i->toJson(json);
+		MojErrCheck(err);
+
+		gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA1, json.data(), json.length());
+		record.append(name.data());
+		record.append(" ");
+		record.append(digest);
+		record.append("\n");
+		g_free(digest);
+	}
+	return MojErrNone;
+}
+
+DbKindConfigurator::UpdateClass DbKindConfigurator::ClassifyUpdate(const std::string& filePath, const std::string& indexes) const
+{
+	ifstream previousFile(StampPath(filePath, INDEX_RECORD_DIR).c_str());
+	if (!previousFile.good())
+		return UpdateNew;
+
+	std::map<std::string, std::string> previous;
+	std::string name, digest;
+	while (previousFile >> name >> digest)
+		previous[name] = digest;
+
+	// removing an index is cheap, adding or redefining one means a rebuild
+	istringstream current(indexes);
+	while (current >> name >> digest) {
+		std::map<std::string, std::string>::const_iterator i = previous.find(name);
+		if (i == previous.end() || i->second != digest) {
+			LOG_DEBUG("Index %s of %s added or changed", name.c_str(), filePath.c_str());
+			return UpdateReindex;
+		}
+	}
+	return UpdateCheap;
+}
+
+void DbKindConfigurator::SaveIndexRecord(const std::string& filePath, const std::string& record) const
+{
+	std::string recordPath = StampPath(filePath, INDEX_RECORD_DIR);
+	MojMkDir((ConfCacheDir() + INDEX_RECORD_DIR).c_str(), kCacheDirPerms);
+	ofstream recordFile(recordPath.c_str(), ios::out | ios::trunc);
+	recordFile << record;
+	if (!recordFile.good()) {
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+				PMLOGKS("file", recordPath.c_str()),
+				"Failed to save index record %s", recordPath.c_str());
+	}
+}
+
 MojErr DbKindConfigurator::CheckOwner(const std::string& filePath, MojObject &params, std::string& ownerid) const
 {
 	ownerid = ParentId(filePath);
@@ -109,10 +236,31 @@ MojErr DbKindConfigurator::ProcessConfig(const string& filePath, MojObject& para
 	MojErr err;
 	std::string owner;
 
+	std::string indexes;
+
 	err = CheckOwner(filePath, params, owner);
 	MojErrCheck(err);
 
-	return m_busClient.CreateRequest(owner.c_str())->send(CreateCallback(filePath)->m_slot, ServiceName(), MOJODB_PUTKIND_METHOD, params);
+	bool applyingDeferred = !m_deferredApplies.empty() &&
+			m_deferredApplies.find(PathTable::Find(filePath)) != m_deferredApplies.end();
+
+	if (CanCacheConfiguratorStatus(filePath)) {
+		err = IndexRecord(params, indexes);
+		MojErrCheck(err);
+
+		// An index rebuild in the middle of the boot sweep competes with launcher
+		// & system apps for db8, so hold those updates back until the run is done
+		if (!applyingDeferred && m_confType == ConfigUnknown && m_currentType == Configure &&
+			ClassifyUpdate(filePath, indexes) == UpdateReindex) {
+			LOG_DEBUG("Deferring re-indexing kind update %s (owner %s)", filePath.c_str(), owner.c_str());
+			m_busClient.DeferKindUpdate(this, filePath, owner);
+			HoldBack(false);
+			return MojErrInProgress;
+		}
+	}
+
+	DbKindConfiguratorResponse* response = new DbKindConfiguratorResponse(this, filePath, indexes, applyingDeferred);
+	return SendRequest(response, MOJODB_PUTKIND_METHOD, params, owner.c_str());
 }
 
 MojErr DbKindConfigurator::ProcessConfigRemoval(const string& filePath, MojObject& params)
@@ -136,7 +284,7 @@ MojErr DbKindConfigurator::ProcessConfigRemoval(const string& filePath, MojObjec
 	err = delKind.putString("id", id);
 	MojErrCheck(err);
 
-	return m_busClient.CreateRequest(owner.c_str())->send(CreateCallback(filePath)->m_slot, ServiceName(), MOJODB_DELKIND_METHOD, delKind);
+	return SendRequest(CreateCallback(filePath), MOJODB_DELKIND_METHOD, delKind, owner.c_str());
 }
 
 ////////////////////////////////////////////////
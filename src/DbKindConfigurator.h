@@ -21,6 +21,7 @@
 
 #include "db/MojDbClient.h"
 #include "Configurator.h"
+#include <map>
 
 class DbKindConfigurator : public Configurator
 {
@@ -28,16 +29,39 @@ public:
 	DbKindConfigurator(const std::string& id, ConfigType confType, RunType type, BusClient& busClient, MojDbClient& dbClient, std::string configDirectory);
 	virtual ~DbKindConfigurator();
 
+	// sends a kind update that was held back during the boot sweep - its
+	// outcome is reported through BusClient::DeferredKindComplete only
+	MojErr ApplyDeferred(const std::string& filePath, const std::string& owner);
+
 protected:
+	enum UpdateClass {
+		UpdateNew,      /// no record of a previous putKind for this file
+		UpdateCheap,    /// indexes unchanged or only removed
+		UpdateReindex,  /// indexes added or changed - db8 will rebuild them
+	};
+
 	virtual MojErr ProcessConfig(const std::string& filePath, MojObject& kind);
 	virtual MojErr ProcessConfigRemoval(const std::string &filePath, MojObject &json);
 
+	virtual ConfiguratorCallback* CreateCallback(const std::string &filePath);
 	virtual const char* ConfiguratorName() const;
 	virtual const char* ServiceName() const;
+	virtual bool RecordsResult(PathTable::PathId config) const;
 	MojErr CheckOwner(const std::string& filePath, MojObject &params, std::string &ownerid) const;
 
+	UpdateClass ClassifyUpdate(const std::string& filePath, const std::string& indexes) const;
+	MojErr      IndexRecord(const MojObject& kind, std::string& record) const;
+	void        SaveIndexRecord(const std::string& filePath, const std::string& record) const;
+
 private:
+	typedef std::map<PathTable::PathId, std::string> DeferredApplyMap;
+
 	MojDbClient& m_dbClient;
+	// held back updates being applied, with their owners - until db8 has
+	// replied, also when the breaker sends one later
+	DeferredApplyMap m_deferredApplies;
+
+	friend class DbKindConfiguratorResponse;
 };
 
 class MediaDbKindConfigurator : public DbKindConfigurator
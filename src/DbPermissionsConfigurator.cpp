@@ -63,12 +63,7 @@ MojErr DbPermissionsConfigurator::ProcessConfig(const string& filePath, MojObjec
 	// for third-party packages, we set the appid on the service request
 	// so that mojodb does things correctly.  root config files aren't split up
 	// in a per-service/app directory way (though they should be like activitymanager)
-	MojRefCountedPtr<MojServiceRequest> request;
-	if (!owner.empty())
-		request = m_busClient.CreateRequest(owner.c_str());
-	else
-		request = m_busClient.CreateRequest();
-	return request->send(CreateCallback(filePath)->m_slot, ServiceName(), MOJODB_PUTPERMISSIONS_METHOD, perms);
+	return SendRequest(CreateCallback(filePath), MOJODB_PUTPERMISSIONS_METHOD, perms, owner.empty() ? NULL : owner.c_str());
 }
 
 MojErr DbPermissionsConfigurator::ProcessConfigRemoval(const string& filePath, MojObject& params)
@@ -0,0 +1,82 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "EventRing.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+EventRing::Entry EventRing::s_records[EventRing::CAPACITY];
+volatile guint32 EventRing::s_next = 0;
+
+void EventRing::Record(Event event, const char* source, const std::string& path, gint32 value)
+{
+	// claiming a slot is the only shared step - a writer never waits
+	guint32 slot = __sync_fetch_and_add(&s_next, 1) & (CAPACITY - 1);
+	Entry& record = s_records[slot];
+
+	// keep the end of the path - that's the part that tells files apart
+	size_t length = path.size();
+	size_t offset = length > PATH_TAIL ? length - PATH_TAIL : 0;
+
+	record.ts = g_get_monotonic_time();
+	record.source = source;
+	record.value = value;
+	record.event = event;
+	record.truncated = offset > 0;
+	record.pathLength = length - offset;
+	memcpy(record.path, path.data() + offset, length - offset);
+}
+
+const char* EventRing::EventName(guint8 event)
+{
+	switch (event) {
+	case Scanned:  return "scanned";
+	case Skipped:  return "skipped";
+	case Sent:     return "sent";
+	case Retried:  return "retried";
+	case Replied:  return "replied";
+	case TimedOut: return "timed-out";
+	case Deferred: return "deferred";
+	case Failed:   return "failed";
+	default:       return "?";
+	}
+}
+
+MojErr EventRing::Dump(const std::string& file)
+{
+	FILE* out = fopen(file.c_str(), "w");
+	if (out == NULL)
+		MojErrThrowMsg(MojErrInternal, "Failed to open %s: %s", file.c_str(), strerror(errno));
+
+	guint32 next = s_next;
+	guint32 first = next > CAPACITY ? next - CAPACITY : 0;
+
+	for (guint32 i = first; i != next; i++) {
+		const Entry& record = s_records[i & (CAPACITY - 1)];
+		fprintf(out, "%lld.%06lld %-9s %-28s %6d %s%.*s\n",
+				(long long)(record.ts / 1000000), (long long)(record.ts % 1000000),
+				EventName(record.event), record.source ? record.source : "-", record.value,
+				record.truncated ? "..." : "", (int)record.pathLength, record.path);
+	}
+
+	if (fclose(out) != 0)
+		MojErrThrowMsg(MojErrInternal, "Failed to write %s: %s", file.c_str(), strerror(errno));
+	return MojErrNone;
+}
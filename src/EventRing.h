@@ -0,0 +1,72 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef EVENTRING_H_
+#define EVENTRING_H_
+
+#include "core/MojCoreDefs.h"
+#include <glib.h>
+#include <string>
+
+/**
+ * Fixed-size ring of binary event records for the hot paths (scan, send,
+ * reply).  Recording copies a few words & the tail of the config path - no
+ * formatting, no allocation.  The ring is only formatted when it is dumped,
+ * on a failed run or on demand (SIGUSR1).
+ */
+class EventRing
+{
+public:
+	enum Event {
+		Scanned,
+		Skipped,
+		Sent,
+		Retried,
+		Replied,
+		TimedOut,
+		Deferred,
+		Failed,
+	};
+
+	// source must outlive the ring (a string literal such as ConfiguratorName())
+	static void Record(Event event, const char* source, const std::string& path, gint32 value = 0);
+
+	// writes the recorded events, oldest first, to file
+	static MojErr Dump(const std::string& file);
+
+private:
+	static const unsigned int CAPACITY = 1024; // power of 2
+	static const unsigned int PATH_TAIL = 64;
+
+	struct Entry {
+		gint64 ts;
+		const char* source;
+		gint32 value;
+		guint8 event;
+		guint8 truncated;
+		guint16 pathLength;
+		char path[PATH_TAIL];
+	};
+
+	static const char* EventName(guint8 event);
+
+	static Entry s_records[CAPACITY];
+	static volatile guint32 s_next;
+};
+
+#endif /* EVENTRING_H_ */
@@ -20,18 +20,40 @@
 #include "BusClient.h"
 #include "FileCacheConfigurator.h"
 
+#include <fstream>
+#include <set>
+
 using namespace std;
 
 const char* const FileCacheConfigurator::FILECACHE_BUS_ADDRESS		 = "com.palm.filecache";
 const char* const FileCacheConfigurator::FILECACHE_DEFINETYPE_METHOD = "DefineType";
 const char* const FileCacheConfigurator::FILECACHE_DELETETYPE_METHOD = "DeleteType";
+const char* const FileCacheConfigurator::FILECACHE_GETTYPES_METHOD   = "GetCacheTypes";
 const char* const FileCacheConfigurator::FILECACHE_TYPENAME_KEY = "typeName";
+const char* const FileCacheConfigurator::FILECACHE_REGISTRY_FILE = "filecache-types";
+
+FileCacheConfigurator::TypeRegistry FileCacheConfigurator::s_registry;
+bool FileCacheConfigurator::s_registryLoaded = false;
+bool FileCacheConfigurator::s_registryDirty = false;
+FileCacheConfigurator::ReconcileState FileCacheConfigurator::s_reconcileState = FileCacheConfigurator::NotReconciled;
 
 static bool endsWith(const std::string& str, const std::string &suffix)
 {
     return str.length() >= suffix.length() && string::npos != str.rfind(suffix, str.length() - suffix.length());
 }
 
+static MojErr paramsDigest(const MojObject& params, std::string& digest)
+{
+	MojString json;
+	MojErr err = params.toJson(json);
+	MojErrCheck(err);
+
+	gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, json.data(), json.length());
+	digest = checksum;
+	g_free(checksum);
+	return MojErrNone;
+}
+
 class FileCacheConfiguratorResponse : public ConfiguratorCallback {
 	// copied from FileCacheError.h - unfortunately this is brittle,
 	// but i'm only using it to cache NAK response for DefineType & I'm doing
@@ -57,8 +79,11 @@ class FileCacheConfiguratorResponse : public ConfiguratorCallback {
 	};
 
 public:
-	FileCacheConfiguratorResponse(FileCacheConfigurator *conf, const string& path)
-		: ConfiguratorCallback(conf, path)
+	FileCacheConfiguratorResponse(FileCacheConfigurator *conf, const string& path, const string& typeName, const string& digest, bool removal)
+		: ConfiguratorCallback(conf, path),
+		  m_typeName(typeName),
+		  m_digest(digest),
+		  m_removal(removal)
 	{
 	}
 
@@ -94,6 +119,11 @@ public:
 						response.del("errorText", found);
 						err = response.putBool("returnValue", true);
 						MarkConfigured();
+
+						// the type stays as it is defined - remember this definition so
+						// that the next run skips it instead of asking again
+						if (!m_removal)
+							FileCacheConfigurator::RegisterType(m_typeName, m_digest);
 					} else {
 						LOG_WARNING(MSGID_FILE_CACHE_CONFIG_WARNING, 2,
 								PMLOGKS("error", errorText.c_str()),
@@ -110,9 +140,81 @@ public:
 			}
 		} else {
 			LOG_DEBUG("FileCacheConfigurator response for %s contained no problems", m_config.c_str());
+			if (m_removal)
+				FileCacheConfigurator::UnregisterType(m_typeName);
+			else
+				FileCacheConfigurator::RegisterType(m_typeName, m_digest);
 		}
 		return DelegateResponse(response, err);
 	}
+
+private:
+	const std::string m_typeName;
+	const std::string m_digest;
+	const bool m_removal;
+};
+
+class FileCacheReconcileResponse : public ReplyHandler {
+public:
+	FileCacheReconcileResponse(BusClient& busClient)
+		: m_busClient(busClient),
+		  m_timer(0)
+	{
+	}
+
+	void ArmTimer()
+	{
+		// the timer keeps us alive - the reply slot lets go of us once cancelled
+		m_timer = g_timeout_add_full(G_PRIORITY_DEFAULT, m_busClient.Policy(FileCacheConfigurator::FILECACHE_BUS_ADDRESS).timeout,
+				&FileCacheReconcileResponse::TimeoutCallback, new MojRefCountedPtr<FileCacheReconcileResponse>(this),
+				&FileCacheReconcileResponse::ReleaseCallback);
+	}
+
+private:
+	static void ReleaseCallback(gpointer data)
+	{
+		delete static_cast<MojRefCountedPtr<FileCacheReconcileResponse>*>(data);
+	}
+
+	static gboolean TimeoutCallback(gpointer data)
+	{
+		FileCacheReconcileResponse* reconcile = static_cast<MojRefCountedPtr<FileCacheReconcileResponse>*>(data)->get();
+		reconcile->m_timer = 0;
+
+		// a listing is only an optimisation - don't hold up the run for it
+		MojObject response(MojObject::TypeObject);
+		reconcile->HandleReply(response, MojErrTimedOut);
+		return false;
+	}
+
+	MojErr HandleReply(MojObject& response, MojErr err)
+	{
+		// cancelling the timer & slot can drop the last references to us
+		MojRefCountedPtr<FileCacheReconcileResponse> self(this);
+		if (m_timer != 0) {
+			g_source_remove(m_timer);
+			m_timer = 0;
+		}
+		Cancel();
+
+		bool success = true;
+		MojObject types;
+		response.get("returnValue", success);
+
+		bool reconciled = !err && success && response.get("types", types);
+		if (!reconciled) {
+			LOG_WARNING(MSGID_FILE_CACHE_CONFIG_WARNING, 1,
+					PMLOGKFV("error", "%d", err),
+					"Failed to list file cache types - defining all types (MojErr: %i)", err);
+		}
+
+		FileCacheConfigurator::Reconcile(types, reconciled);
+		m_busClient.RunNextConfigurator();
+		return MojErrNone;
+	}
+
+	BusClient& m_busClient;
+	unsigned int m_timer;
 };
 
 const char* FileCacheConfigurator::ConfiguratorName() const
@@ -128,24 +230,162 @@ const char* FileCacheConfigurator::ServiceName() const
 FileCacheConfigurator::FileCacheConfigurator(const std::string& id, ConfigType confType, RunType type, BusClient& busClient, string configDirectory)
 : Configurator(id, confType, type, busClient, configDirectory)
 {
-
+	LoadRegistry();
 }
 
 FileCacheConfigurator::~FileCacheConfigurator()
 {
-
+	SaveRegistry();
 }
 
 ConfiguratorCallback* FileCacheConfigurator::CreateCallback(const string& filePath)
 {
-	return new FileCacheConfiguratorResponse(this, filePath);
+	return new FileCacheConfiguratorResponse(this, filePath, std::string(), std::string(), m_currentType == RemoveConfiguration);
+}
+
+void FileCacheConfigurator::LoadRegistry()
+{
+	if (s_registryLoaded)
+		return;
+	s_registryLoaded = true;
+
+	std::string registryPath = ConfCacheDir() + FILECACHE_REGISTRY_FILE;
+	ifstream registryFile(registryPath.c_str());
+	std::string line;
+
+	// one line per type: "<typeName>\t<digest>"
+	while (getline(registryFile, line)) {
+		size_t tab = line.find('\t');
+		if (tab == string::npos)
+			continue;
+		s_registry[line.substr(0, tab)] = line.substr(tab + 1);
+	}
+	LOG_DEBUG("Loaded %zu file cache types from %s", s_registry.size(), registryPath.c_str());
+}
+
+void FileCacheConfigurator::SaveRegistry()
+{
+	if (!s_registryDirty)
+		return;
+
+	std::string registryPath = ConfCacheDir() + FILECACHE_REGISTRY_FILE;
+	ofstream registryFile(registryPath.c_str(), ios::out | ios::trunc);
+	for (TypeRegistry::const_iterator i = s_registry.begin(); i != s_registry.end(); ++i)
+		registryFile << i->first << '\t' << i->second << '\n';
+
+	if (!registryFile.good()) {
+		LOG_WARNING(MSGID_FILE_CACHE_CONFIG_WARNING, 1,
+				PMLOGKS("file", registryPath.c_str()),
+				"Failed to save file cache type registry %s", registryPath.c_str());
+		return;
+	}
+	s_registryDirty = false;
+}
+
+void FileCacheConfigurator::RegisterType(const std::string& typeName, const std::string& digest)
+{
+	if (typeName.empty())
+		return;
+	s_registry[typeName] = digest;
+	s_registryDirty = true;
+}
+
+void FileCacheConfigurator::UnregisterType(const std::string& typeName)
+{
+	if (s_registry.erase(typeName))
+		s_registryDirty = true;
+}
+
+void FileCacheConfigurator::Reconcile(const MojObject& types, bool succeeded)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	if (!succeeded) {
+		// can't tell what the file cache knows about, so every type gets defined
+		s_reconcileState = ReconcileFailed;
+		return;
+	}
+
+	std::set<std::string> defined;
+	for (MojObject::ConstArrayIterator i = types.arrayBegin(); i != NULL && i != types.arrayEnd(); ++i) {
+		MojString typeName;
+		if (i->stringValue(typeName) == MojErrNone)
+			defined.insert(typeName.data());
+	}
+
+	// forget types the file cache lost (e.g. it was wiped) ...
+	for (TypeRegistry::iterator i = s_registry.begin(); i != s_registry.end(); ) {
+		if (defined.find(i->first) == defined.end()) {
+			LOG_DEBUG("File cache type %s no longer defined", i->first.c_str());
+			s_registry.erase(i++);
+			s_registryDirty = true;
+		} else {
+			++i;
+		}
+	}
+
+	// ... and pick up ones defined without going through the registry
+	for (std::set<std::string>::const_iterator i = defined.begin(); i != defined.end(); ++i) {
+		if (s_registry.find(*i) == s_registry.end())
+			RegisterType(*i, std::string());
+	}
+
+	LOG_DEBUG("Reconciled file cache type registry - %zu types defined", s_registry.size());
+	s_reconcileState = Reconciled;
+}
+
+bool FileCacheConfigurator::ReadyToProcess()
+{
+	if (m_currentType == RemoveConfiguration)
+		return true;
+
+	switch (s_reconcileState) {
+	case Reconciled:
+	case ReconcileFailed:
+		return true;
+	case Reconciling:
+		return false;
+	case NotReconciled:
+		break;
+	}
+
+	// one bulk request instead of a failing DefineType per known type
+	s_reconcileState = Reconciling;
+
+	FileCacheReconcileResponse* response = new FileCacheReconcileResponse(m_busClient);
+	MojObject params(MojObject::TypeObject);
+	MojErr err = m_busClient.Send(response, FILECACHE_BUS_ADDRESS, FILECACHE_GETTYPES_METHOD, params);
+	if (err) {
+		Reconcile(MojObject(), false);
+		return true;
+	}
+	response->ArmTimer();
+	return false;
 }
 
 MojErr FileCacheConfigurator::ProcessConfig(const string& filePath, MojObject& params)
 {
 	LOG_TRACE("Entering function %s", __FUNCTION__);
+	MojErr err;
+
+	MojString typeName;
+	std::string digest;
+	err = params.getRequired(FILECACHE_TYPENAME_KEY, typeName); MojErrCheck(err);
+	err = paramsDigest(params, digest); MojErrCheck(err);
+
+	if (s_reconcileState == Reconciled) {
+		// DefineType of a type the file cache already has would only come back with "already exists"
+		TypeRegistry::const_iterator i = s_registry.find(typeName.data());
+		if (i != s_registry.end() && (i->second.empty() || i->second == digest)) {
+			LOG_DEBUG("File cache type %s already defined - skipping %s", typeName.data(), filePath.c_str());
+			RegisterType(i->first, digest);
+			MarkConfigured(filePath);
+			return MojErrInProgress;
+		}
+	}
 
-	return m_busClient.CreateRequest()->send(CreateCallback(filePath)->m_slot, FILECACHE_BUS_ADDRESS, FILECACHE_DEFINETYPE_METHOD, params);
+	FileCacheConfiguratorResponse* response = new FileCacheConfiguratorResponse(this, filePath, typeName.data(), digest, false);
+	return SendRequest(response, FILECACHE_DEFINETYPE_METHOD, params);
 }
 
 MojErr FileCacheConfigurator::ProcessConfigRemoval(const string& filePath, MojObject& params)
@@ -159,5 +399,6 @@ MojErr FileCacheConfigurator::ProcessConfigRemoval(const string& filePath, MojOb
 	MojObject request(MojObject::TypeObject);
 	err = request.putString(FILECACHE_TYPENAME_KEY, typeName); 	MojErrCheck(err);
 
-	return m_busClient.CreateRequest()->send(CreateCallback(filePath)->m_slot, ServiceName(), FILECACHE_DELETETYPE_METHOD, request);
+	FileCacheConfiguratorResponse* response = new FileCacheConfiguratorResponse(this, filePath, typeName.data(), std::string(), true);
+	return SendRequest(response, FILECACHE_DELETETYPE_METHOD, request);
 }
@@ -20,6 +20,7 @@
 #define FILECACHECONFIGURATOR_H_
 
 #include "Configurator.h"
+#include <map>
 
 class FileCacheConfigurator : public Configurator
 {
@@ -34,12 +35,42 @@ protected:
 	virtual ConfiguratorCallback* CreateCallback(const std::string& filePath);
 	virtual const char* ConfiguratorName() const;
 	virtual const char* ServiceName() const;
+	virtual bool ReadyToProcess();
 
 private:
+	/**
+	 * Key = file cache type name
+	 * Value = digest of the DefineType parameters last accepted by the file
+	 *         cache (empty if the type exists but its definition isn't known)
+	 */
+	typedef std::map<std::string, std::string> TypeRegistry;
+
+	static void LoadRegistry();
+	static void SaveRegistry();
+	static void RegisterType(const std::string& typeName, const std::string& digest);
+	static void UnregisterType(const std::string& typeName);
+	static void Reconcile(const MojObject& types, bool succeeded);
+
 	static const char* const FILECACHE_BUS_ADDRESS;
 	static const char* const FILECACHE_DEFINETYPE_METHOD;
 	static const char* const FILECACHE_DELETETYPE_METHOD;
+	static const char* const FILECACHE_GETTYPES_METHOD;
 	static const char* const FILECACHE_TYPENAME_KEY;
+	static const char* const FILECACHE_REGISTRY_FILE;
+
+	static TypeRegistry s_registry;
+	static bool s_registryLoaded;
+	static bool s_registryDirty;
+
+	static enum ReconcileState {
+		NotReconciled,
+		Reconciling,
+		Reconciled,
+		ReconcileFailed,
+	} s_reconcileState;
+
+	friend class FileCacheConfiguratorResponse;
+	friend class FileCacheReconcileResponse;
 };
 
 #endif /* FILECACHECONFIGURATOR_H_ */
@@ -0,0 +1,208 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "FirstUseQueue.h"
+#include "Log.h"
+
+#include <errno.h>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char* const FirstUseQueue::QUEUE_FILE             = "first-use-queue.json";
+const char* const FirstUseQueue::FIRST_USE_FLAG         = "/var/luna/preferences/ran-first-use";
+const char* const FirstUseQueue::FIRST_USE_PROFILE_FLAG = "/var/luna/preferences/first-use-profile-created";
+
+FirstUseQueue::FirstUseQueue()
+	: m_completed(false),
+	  m_dirty(false)
+{
+}
+
+void FirstUseQueue::Load(const std::string& root)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	m_root = root;
+#ifdef WEBOS_TARGET_MACHINE_STANDALONE
+	// there is no first use run on the desktop
+	m_completed = true;
+#else
+	m_completed = CheckFlags();
+#endif
+
+	std::string queueFile = Configurator::ConfCacheDir() + QUEUE_FILE;
+	ifstream file(queueFile.c_str());
+	if (!file.good())
+		return;
+
+	std::string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	MojObject queue;
+	if (queue.fromJson(json.c_str()) != MojErrNone) {
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+				PMLOGKS("file", queueFile.c_str()),
+				"Failed to parse %s - dropping the first use queue", queueFile.c_str());
+		m_dirty = true;
+		return;
+	}
+
+	// [{"id": ..., "dir": ..., "type": ..., "path": ...}, ...]
+	for (MojObject::ConstArrayIterator i = queue.arrayBegin(); i != queue.arrayEnd(); ++i) {
+		MojString id, directory, path;
+		MojInt64 type = Configurator::ConfigUnknown;
+		bool found = false;
+		Entry entry;
+
+		if (i->get("id", id, found) == MojErrNone && found)
+			entry.id.assign(id.data(), id.length());
+		found = false;
+		if (i->get("dir", directory, found) != MojErrNone || !found)
+			continue;
+		found = false;
+		if (i->get("path", path, found) != MojErrNone || !found)
+			continue;
+		i->get("type", type);
+
+		entry.directory.assign(directory.data(), directory.length());
+		entry.path.assign(path.data(), path.length());
+		entry.type = static_cast<Configurator::ConfigType>(type);
+		m_entries.push_back(entry);
+	}
+	LOG_DEBUG("%zd activities waiting for first use", m_entries.size());
+}
+
+bool FirstUseQueue::Completed() const
+{
+	return m_completed;
+}
+
+bool FirstUseQueue::Recheck()
+{
+	if (!m_completed && CheckFlags()) {
+		LOG_DEBUG("First use has completed, %zd activities waiting", m_entries.size());
+		m_completed = true;
+	}
+	return m_completed;
+}
+
+void FirstUseQueue::Add(const std::string& id, const std::string& directory, Configurator::ConfigType type, const std::string& path)
+{
+	for (EntryList::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+		if (i->path == path)
+			return;
+	}
+
+	Entry entry;
+	entry.id = id;
+	entry.directory = directory;
+	entry.type = type;
+	entry.path = path;
+	m_entries.push_back(entry);
+	m_dirty = true;
+}
+
+void FirstUseQueue::Forget(const std::string& id)
+{
+	for (EntryList::iterator i = m_entries.begin(); i != m_entries.end(); ) {
+		if (i->id == id) {
+			i = m_entries.erase(i);
+			m_dirty = true;
+		} else {
+			++i;
+		}
+	}
+	Save();
+}
+
+const FirstUseQueue::EntryList& FirstUseQueue::Entries() const
+{
+	return m_entries;
+}
+
+void FirstUseQueue::Registered(const std::string& path)
+{
+	for (EntryList::iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+		if (i->path == path) {
+			m_entries.erase(i);
+			m_dirty = true;
+			Save();
+			return;
+		}
+	}
+}
+
+void FirstUseQueue::Save()
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	if (!m_dirty)
+		return;
+
+	std::string queueFile = Configurator::ConfCacheDir() + QUEUE_FILE;
+	if (m_entries.empty()) {
+		if (unlink(queueFile.c_str()) != 0 && errno != ENOENT) {
+			LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+					PMLOGKS("file", queueFile.c_str()),
+					"Failed to remove %s", queueFile.c_str());
+			return;
+		}
+		m_dirty = false;
+		return;
+	}
+
+	MojObject queue(MojObject::TypeArray);
+	for (EntryList::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+		MojObject entry(MojObject::TypeObject);
+		if (entry.putString("id", i->id.c_str()) != MojErrNone ||
+				entry.putString("dir", i->directory.c_str()) != MojErrNone ||
+				entry.putInt("type", i->type) != MojErrNone ||
+				entry.putString("path", i->path.c_str()) != MojErrNone ||
+				queue.push(entry) != MojErrNone)
+			return;
+	}
+
+	MojString json;
+	if (queue.toJson(json) != MojErrNone)
+		return;
+
+	// written aside & renamed, so that a crash never leaves half a queue
+	std::string tmpFile = queueFile + ".tmp";
+	ofstream file(tmpFile.c_str(), ios::out | ios::trunc);
+	file << json.data();
+	file.close();
+	if (!file.good() || rename(tmpFile.c_str(), queueFile.c_str()) != 0) {
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+				PMLOGKS("file", queueFile.c_str()),
+				"Failed to save the first use queue to %s", queueFile.c_str());
+		unlink(tmpFile.c_str());
+		return;
+	}
+	m_dirty = false;
+}
+
+bool FirstUseQueue::CheckFlags() const
+{
+	struct stat buf;
+	return stat((m_root + FIRST_USE_FLAG).c_str(), &buf) == 0 &&
+			stat((m_root + FIRST_USE_PROFILE_FLAG).c_str(), &buf) == 0;
+}
@@ -0,0 +1,79 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef FIRSTUSEQUEUE_H_
+#define FIRSTUSEQUEUE_H_
+
+#include "Configurator.h"
+#include <string>
+#include <vector>
+
+/**
+ * Activities that aren't firstUseSafe are held back until first use has
+ * completed.  They are recorded here (& kept in the cache directory across
+ * restarts) so that once first use is done exactly those get registered -
+ * without walking the activity directories again.
+ *
+ * The first use flags are stat'ed at startup & again when the upstart job
+ * calls firstUseComplete - that request is what registers the queue.  Entries
+ * leave the queue only once their activity has been created.
+ */
+class FirstUseQueue
+{
+public:
+	// what the configurator that held the activity back was run with
+	struct Entry {
+		std::string id;
+		std::string directory;
+		Configurator::ConfigType type;
+		std::string path;
+	};
+
+	typedef std::vector<Entry> EntryList;
+
+	FirstUseQueue();
+
+	// reads the queue & the flags under root
+	void Load(const std::string& root);
+	bool Completed() const;
+	// looks at the flags again - for a process started before first use ended
+	bool Recheck();
+
+	void Add(const std::string& id, const std::string& directory, Configurator::ConfigType type, const std::string& path);
+	// the app is being unconfigured - its activities won't be needed
+	void Forget(const std::string& id);
+	const EntryList& Entries() const;
+	// the activity at path has been created - it leaves the queue
+	void Registered(const std::string& path);
+	// writes the queue if it changed since the last save
+	void Save();
+
+private:
+	static const char* const QUEUE_FILE;
+	static const char* const FIRST_USE_FLAG;
+	static const char* const FIRST_USE_PROFILE_FLAG;
+
+	bool CheckFlags() const;
+
+	std::string m_root;
+	bool m_completed;
+	EntryList m_entries;
+	bool m_dirty;
+};
+
+#endif /* FIRSTUSEQUEUE_H_ */
@@ -13,23 +13,66 @@
  * ... - key-value pairs and free text. key-value pairs are formed using PMLOGKS or PMLOGKFV e.g.)
  * LOG_CRITICAL(msgid, 2, PMLOGKS("key1", "value1"), PMLOGKFV("key2", "%d", value2), "free text message");
  */
+/* Levels below CONFIGURATOR_LOG_LEVEL are compiled out - their arguments are
+ * still type checked but never evaluated.  Set at configure time with
+ * -DCONFIGURATOR_LOG_LEVEL=<critical|error|warning|info|debug|trace>.
+ */
+#define CONFIGURATOR_LOG_CRITICAL 0
+#define CONFIGURATOR_LOG_ERROR    1
+#define CONFIGURATOR_LOG_WARNING  2
+#define CONFIGURATOR_LOG_INFO     3
+#define CONFIGURATOR_LOG_DEBUG    4
+#define CONFIGURATOR_LOG_TRACE    5
+
+#ifndef CONFIGURATOR_LOG_LEVEL
+#define CONFIGURATOR_LOG_LEVEL CONFIGURATOR_LOG_TRACE
+#endif
+
+#define LOG_COMPILED_OUT(call) \
+do { if (0) { call; } } while (0)
+
 #define LOG_CRITICAL(msgid, kvcount, ...) \
 PmLogCritical(getactivitymanagercontext(), msgid, kvcount, ##__VA_ARGS__)
 
+#if CONFIGURATOR_LOG_LEVEL >= CONFIGURATOR_LOG_ERROR
 #define LOG_ERROR(msgid, kvcount, ...) \
 PmLogError(getactivitymanagercontext(), msgid, kvcount,##__VA_ARGS__)
+#else
+#define LOG_ERROR(msgid, kvcount, ...) \
+LOG_COMPILED_OUT(PmLogError(getactivitymanagercontext(), msgid, kvcount,##__VA_ARGS__))
+#endif
 
+#if CONFIGURATOR_LOG_LEVEL >= CONFIGURATOR_LOG_WARNING
 #define LOG_WARNING(msgid, kvcount, ...) \
 PmLogWarning(getactivitymanagercontext(), msgid, kvcount, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(msgid, kvcount, ...) \
+LOG_COMPILED_OUT(PmLogWarning(getactivitymanagercontext(), msgid, kvcount, ##__VA_ARGS__))
+#endif
 
+#if CONFIGURATOR_LOG_LEVEL >= CONFIGURATOR_LOG_INFO
 #define LOG_INFO(msgid, kvcount, ...) \
 PmLogInfo(getactivitymanagercontext(), msgid, kvcount, ##__VA_ARGS__)
+#else
+#define LOG_INFO(msgid, kvcount, ...) \
+LOG_COMPILED_OUT(PmLogInfo(getactivitymanagercontext(), msgid, kvcount, ##__VA_ARGS__))
+#endif
 
+#if CONFIGURATOR_LOG_LEVEL >= CONFIGURATOR_LOG_DEBUG
 #define LOG_DEBUG(...) \
 PmLogDebug(getactivitymanagercontext(), ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) \
+LOG_COMPILED_OUT(PmLogDebug(getactivitymanagercontext(), ##__VA_ARGS__))
+#endif
 
+#if CONFIGURATOR_LOG_LEVEL >= CONFIGURATOR_LOG_TRACE
 #define LOG_TRACE(...) \
 PMLOG_TRACE(__VA_ARGS__);
+#else
+#define LOG_TRACE(...) \
+do { } while (0);
+#endif
 
 #define MSGID_BUS_CLIENT_ERROR              "BUS_CLIENT_ERROR"
 #define MSGID_ACTIVITY_CONFIGURATOR_ERROR   "ACTIVITY_CONFIGURATOR_ERROR"
@@ -39,6 +82,10 @@ PMLOG_TRACE(__VA_ARGS__);
 #define MSGID_CONFIGURATOR_WARNING          "CONFIGURATOR_WARNING"
 #define MSGID_CONFIGURATOR_ERROR            "CONFIGURATOR_ERROR"
 #define MSGID_SHUTDOWN_ERROR                "SHUTDOWN_ERROR"
+#define MSGID_MOCK_BACKEND                  "MOCK_BACKEND"
+#define MSGID_STATS                         "STATS"
+#define MSGID_TRACE                         "TRACE"
+#define MSGID_EVENT_RING                    "EVENT_RING"
 
 extern PmLogContext getactivitymanagercontext();
 
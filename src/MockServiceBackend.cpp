@@ -0,0 +1,253 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "core/MojObject.h"
+#include "MockServiceBackend.h"
+#include "Log.h"
+
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+// file cache's error for a type that is already defined (FCDefineError)
+static const MojInt64 FILECACHE_DEFINE_ERROR = -197;
+
+MockServiceBackend::MockServiceBackend()
+	: m_totalMessages(0)
+{
+	m_default.latency = 1;
+	m_default.jitter = 0;
+	m_default.errorRate = 0.0;
+	m_default.errorCode = MojErrInternal;
+	m_default.errorText = "Mock failure";
+}
+
+MockServiceBackend::~MockServiceBackend()
+{
+	LOG_INFO(MSGID_MOCK_BACKEND, 1,
+			PMLOGKFV("messages", "%u", m_totalMessages),
+			"Mock service backend handled %u messages", m_totalMessages);
+
+	if (!m_reportFile.empty())
+		WriteReport();
+}
+
+void MockServiceBackend::WriteReport() const
+{
+	MojObject summary(MojObject::TypeObject);
+	MojString json;
+
+	if (Summary(summary) != MojErrNone || summary.toJson(json) != MojErrNone)
+		return;
+
+	ofstream report(m_reportFile.c_str(), ios::out | ios::trunc);
+	report << json.data() << '\n';
+	if (!report.good()) {
+		LOG_WARNING(MSGID_MOCK_BACKEND, 1,
+				PMLOGKS("file", m_reportFile.c_str()),
+				"Failed to write mock report to %s", m_reportFile.c_str());
+	}
+}
+
+void MockServiceBackend::ReadBehaviour(const MojObject& settings, MethodBehaviour& behaviour)
+{
+	MojInt64 value;
+	MojObject rate;
+	MojString text;
+	bool found = false;
+
+	if (settings.get("latency", value) && value >= 0)
+		behaviour.latency = value;
+	if (settings.get("jitter", value) && value >= 0)
+		behaviour.jitter = value;
+	if (settings.get("errorRate", rate))
+		behaviour.errorRate = rate.decimalValue().floatValue();
+	if (settings.get("errorCode", value))
+		behaviour.errorCode = value;
+	if (settings.get("errorText", text, found) && found)
+		behaviour.errorText = text.data();
+}
+
+MojErr MockServiceBackend::Load(const std::string& settingsFile)
+{
+	ifstream file(settingsFile.c_str());
+	if (!file.good())
+		MojErrThrowMsg(MojErrNotFound, "mock settings %s not found", settingsFile.c_str());
+
+	std::string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	MojObject settings;
+	MojErr err = settings.fromJson(json.c_str());
+	MojErrCheck(err);
+
+	ReadBehaviour(settings, m_default);
+
+	MojString report;
+	bool found = false;
+	err = settings.get("report", report, found);
+	MojErrCheck(err);
+	if (found)
+		m_reportFile = report.data();
+
+	MojObject methods;
+	if (settings.get("methods", methods)) {
+		for (MojObject::ConstIterator i = methods.begin(); i != methods.end(); ++i) {
+			MethodBehaviour behaviour = m_default;
+			ReadBehaviour(i.value(), behaviour);
+			m_methods[i.key().data()] = behaviour;
+		}
+	}
+
+	MojObject absent;
+	if (settings.get("absent", absent)) {
+		for (MojObject::ConstArrayIterator i = absent.arrayBegin(); i != NULL && i != absent.arrayEnd(); ++i) {
+			MojString service;
+			err = i->stringValue(service);
+			MojErrCheck(err);
+			m_absentServices.insert(service.data());
+		}
+	}
+	return MojErrNone;
+}
+
+MojErr MockServiceBackend::Summary(MojObject& summary) const
+{
+	MojErr err = summary.putInt("messages", m_totalMessages);
+	MojErrCheck(err);
+
+	MojObject methods(MojObject::TypeObject);
+	for (MessageCountMap::const_iterator i = m_messages.begin(); i != m_messages.end(); ++i) {
+		err = methods.putInt(i->first.c_str(), i->second);
+		MojErrCheck(err);
+	}
+	return summary.put("methods", methods);
+}
+
+const MockServiceBackend::MethodBehaviour& MockServiceBackend::Behaviour(const std::string& service, const std::string& method) const
+{
+	BehaviourMap::const_iterator i = m_methods.find(service + "/" + method);
+	if (i == m_methods.end())
+		i = m_methods.find(method);
+	if (i == m_methods.end())
+		return m_default;
+	return i->second;
+}
+
+MojErr MockServiceBackend::Fail(MojObject& response, MojInt64 errorCode, const std::string& errorText)
+{
+	MojErr err = response.putBool("returnValue", false);
+	MojErrCheck(err);
+	err = response.putInt("errorCode", errorCode);
+	MojErrCheck(err);
+	return response.putString("errorText", errorText.c_str());
+}
+
+MojErr MockServiceBackend::Reply(const std::string& service, const std::string& method, const MojObject& payload, MojObject& response, MojErr& replyErr)
+{
+	MojErr err;
+	replyErr = MojErrNone;
+
+	if (method == "signal/registerServerStatus") {
+		MojString serviceName;
+		err = payload.getRequired("serviceName", serviceName);
+		MojErrCheck(err);
+		err = response.putString("serviceName", serviceName);
+		MojErrCheck(err);
+		return response.putBool("connected", m_absentServices.find(serviceName.data()) == m_absentServices.end());
+	}
+
+	if (m_absentServices.find(service) != m_absentServices.end()) {
+		replyErr = MojErrInternal;
+		return Fail(response, -1, "Service does not exist: " + service + ".");
+	}
+
+	const MethodBehaviour& behaviour = Behaviour(service, method);
+	if (behaviour.errorRate > 0.0 && g_random_double() < behaviour.errorRate) {
+		replyErr = (MojErr) behaviour.errorCode;
+		return Fail(response, behaviour.errorCode, behaviour.errorText);
+	}
+
+	// the file cache is the only target whose replies depend on earlier requests
+	if (method == "DefineType" || method == "DeleteType") {
+		MojString typeName;
+		err = payload.getRequired("typeName", typeName);
+		MojErrCheck(err);
+
+		if (method == "DeleteType") {
+			m_fileCacheTypes.erase(typeName.data());
+		} else if (!m_fileCacheTypes.insert(typeName.data()).second) {
+			replyErr = MojErrInternal;
+			return Fail(response, FILECACHE_DEFINE_ERROR, std::string("Cache type '") + typeName.data() + "' already exists.");
+		}
+	} else if (method == "GetCacheTypes") {
+		MojObject types(MojObject::TypeArray);
+		for (std::set<std::string>::const_iterator i = m_fileCacheTypes.begin(); i != m_fileCacheTypes.end(); ++i) {
+			MojString typeName;
+			err = typeName.assign(i->c_str());
+			MojErrCheck(err);
+			err = types.push(MojObject(typeName));
+			MojErrCheck(err);
+		}
+		err = response.put("types", types);
+		MojErrCheck(err);
+	}
+
+	return response.putBool("returnValue", true);
+}
+
+MojErr MockServiceBackend::Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies)
+{
+	m_totalMessages++;
+	m_messages[std::string(service) + "/" + method]++;
+
+	PendingReply* reply = new PendingReply;
+	reply->handler.reset(handler);
+	reply->generation = handler->Generation();
+	reply->response = MojObject(MojObject::TypeObject);
+
+	MojErr err = Reply(service, method, payload, reply->response, reply->err);
+	if (err) {
+		delete reply;
+		MojErrThrow(err);
+	}
+
+	const MethodBehaviour& behaviour = Behaviour(service, method);
+	unsigned int latency = behaviour.latency;
+	if (behaviour.jitter > 0)
+		latency += g_random_int_range(0, behaviour.jitter + 1);
+
+	g_timeout_add_full(G_PRIORITY_DEFAULT, latency, &MockServiceBackend::DeliverCallback, reply, &MockServiceBackend::ReleaseCallback);
+	return MojErrNone;
+}
+
+gboolean MockServiceBackend::DeliverCallback(gpointer data)
+{
+	PendingReply* reply = static_cast<PendingReply*>(data);
+
+	// cancelled (e.g. timed out) since it was sent
+	if (reply->generation != reply->handler->Generation())
+		return false;
+
+	reply->handler->HandleReply(reply->response, reply->err);
+	return false;
+}
+
+void MockServiceBackend::ReleaseCallback(gpointer data)
+{
+	delete static_cast<PendingReply*>(data);
+}
@@ -0,0 +1,96 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef MOCKSERVICEBACKEND_H_
+#define MOCKSERVICEBACKEND_H_
+
+#include "ServiceBackend.h"
+#include <glib.h>
+#include <map>
+#include <set>
+#include <string>
+
+/**
+ * Local stand-in for db8, the file cache & the activity manager so that the
+ * whole BusClient & configurator pipeline can run without a bus.
+ *
+ * Replies are delivered from the main loop after a per-method latency & fail
+ * at a per-method rate, both read from an optional settings file:
+ *
+ * {
+ *   "latency": 2, "jitter": 1,
+ *   "methods": {
+ *     "putKind": { "latency": 20, "jitter": 10, "errorRate": 0.01 },
+ *     "com.palm.activitymanager/create": { "errorRate": 0.5, "errorCode": -1003 }
+ *   },
+ *   "absent": [ "com.webos.mediadb" ],
+ *   "report": "/tmp/mock-report.json"
+ * }
+ *
+ * Methods are looked up as "service/method" first, then "method".  If "report"
+ * is set the message counts (see Summary) are written there as JSON on exit.
+ */
+class MockServiceBackend : public ServiceBackend
+{
+public:
+	MockServiceBackend();
+	virtual ~MockServiceBackend();
+
+	MojErr Load(const std::string& settingsFile);
+	MojErr Summary(MojObject& summary) const;
+
+	virtual MojErr Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies);
+
+private:
+	struct MethodBehaviour {
+		unsigned int latency;  /// ms
+		unsigned int jitter;   /// ms, added uniformly on top of latency
+		double errorRate;      /// 0..1
+		MojInt64 errorCode;
+		std::string errorText;
+	};
+
+	struct PendingReply {
+		MojRefCountedPtr<ReplyHandler> handler;
+		unsigned int generation;
+		MojObject response;
+		MojErr err;
+	};
+
+	typedef std::map<std::string, MethodBehaviour> BehaviourMap;
+	typedef std::map<std::string, unsigned int> MessageCountMap;
+
+	static void ReadBehaviour(const MojObject& settings, MethodBehaviour& behaviour);
+	static gboolean DeliverCallback(gpointer data);
+	static void ReleaseCallback(gpointer data);
+
+	const MethodBehaviour& Behaviour(const std::string& service, const std::string& method) const;
+	MojErr Reply(const std::string& service, const std::string& method, const MojObject& payload, MojObject& response, MojErr& err);
+	static MojErr Fail(MojObject& response, MojInt64 errorCode, const std::string& errorText);
+	void WriteReport() const;
+
+	MethodBehaviour m_default;
+	BehaviourMap m_methods;
+	std::set<std::string> m_absentServices;
+	std::set<std::string> m_fileCacheTypes;
+	MessageCountMap m_messages;
+	unsigned int m_totalMessages;
+	std::string m_reportFile;
+};
+
+#endif /* MOCKSERVICEBACKEND_H_ */
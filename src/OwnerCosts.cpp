@@ -0,0 +1,196 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "OwnerCosts.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+
+const unsigned int OwnerCosts::REPORT_SIZE = 100;
+
+void OwnerCosts::Read(const std::string& owner, size_t bytes)
+{
+	m_costs[owner].bytesRead += bytes;
+}
+
+void OwnerCosts::Parsed(const std::string& owner, gint64 parseUs)
+{
+	m_costs[owner].parseUs += parseUs;
+}
+
+void OwnerCosts::Requested(const std::string& owner)
+{
+	m_costs[owner].requests++;
+}
+
+void OwnerCosts::Replied(const std::string& owner, gint64 latencyUs)
+{
+	m_costs[owner].latencyUs += latencyUs;
+}
+
+bool OwnerCosts::ParseSortKey(const std::string& name, SortKey& key)
+{
+	if (name == "latency")
+		key = ByLatency;
+	else if (name == "bytes")
+		key = ByBytes;
+	else if (name == "parse")
+		key = ByParseTime;
+	else if (name == "requests")
+		key = ByRequests;
+	else
+		return false;
+	return true;
+}
+
+namespace {
+
+struct Heavier {
+	Heavier(OwnerCosts::SortKey key) : m_key(key) {}
+
+	template <class Entry>
+	MojInt64 Weight(const Entry& entry) const
+	{
+		switch (m_key) {
+		case OwnerCosts::ByBytes:     return entry->second.bytesRead;
+		case OwnerCosts::ByParseTime: return entry->second.parseUs;
+		case OwnerCosts::ByRequests:  return entry->second.requests;
+		default:                      return entry->second.latencyUs;
+		}
+	}
+
+	template <class Entry>
+	bool operator()(const Entry& a, const Entry& b) const
+	{
+		return Weight(a) > Weight(b);
+	}
+
+	OwnerCosts::SortKey m_key;
+};
+
+} // namespace
+
+MojErr OwnerCosts::Top(const CostMap& costs, unsigned int n, SortKey key, MojObject& owners)
+{
+	vector<CostMap::const_iterator> sorted;
+	for (CostMap::const_iterator i = costs.begin(); i != costs.end(); ++i)
+		sorted.push_back(i);
+
+	n = std::min<size_t>(n, sorted.size());
+	partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(), Heavier(key));
+
+	for (unsigned int i = 0; i < n; i++) {
+		const Cost& cost = sorted[i]->second;
+		MojObject owner(MojObject::TypeObject);
+		MojErr err;
+
+		err = owner.putString("owner", sorted[i]->first.c_str()); MojErrCheck(err);
+		err = owner.putInt("bytesRead", cost.bytesRead); MojErrCheck(err);
+		err = owner.putInt("parseUs", cost.parseUs); MojErrCheck(err);
+		err = owner.putInt("requests", cost.requests); MojErrCheck(err);
+		err = owner.putInt("latencyMs", cost.latencyUs / 1000); MojErrCheck(err);
+		err = owners.push(owner); MojErrCheck(err);
+	}
+	return MojErrNone;
+}
+
+MojErr OwnerCosts::Top(unsigned int n, SortKey key, MojObject& owners) const
+{
+	return Top(m_costs, n, key, owners);
+}
+
+std::string OwnerCosts::BootId()
+{
+	ifstream file("/proc/sys/kernel/random/boot_id");
+	std::string bootId;
+	getline(file, bootId);
+	return bootId;
+}
+
+MojErr OwnerCosts::Load(const std::string& reportFile, MojObject& report)
+{
+	ifstream file(reportFile.c_str());
+	if (!file.good())
+		MojErrThrow(MojErrNotFound);
+
+	std::string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	MojErr err = report.fromJson(json.c_str());
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+MojErr OwnerCosts::Save(const std::string& reportFile) const
+{
+	std::string bootId = BootId();
+	CostMap merged = m_costs;
+
+	// earlier runs of this boot (the service exits when idle) are added in
+	MojObject previous;
+	MojString previousBoot;
+	bool found = false;
+	if (Load(reportFile, previous) == MojErrNone &&
+			previous.get("bootId", previousBoot, found) == MojErrNone && found &&
+			bootId == previousBoot.data()) {
+		MojObject owners;
+		if (previous.get("owners", owners)) {
+			for (MojObject::ConstArrayIterator i = owners.arrayBegin(); i != NULL && i != owners.arrayEnd(); ++i) {
+				MojString name;
+				MojInt64 value;
+				if (i->get("owner", name, found) != MojErrNone || !found)
+					continue;
+
+				Cost& cost = merged[name.data()];
+				if (i->get("bytesRead", value))
+					cost.bytesRead += value;
+				if (i->get("parseUs", value))
+					cost.parseUs += value;
+				if (i->get("requests", value))
+					cost.requests += value;
+				if (i->get("latencyMs", value))
+					cost.latencyUs += value * 1000;
+			}
+		}
+	}
+
+	MojObject owners(MojObject::TypeArray);
+	MojErr err = Top(merged, REPORT_SIZE, ByLatency, owners);
+	MojErrCheck(err);
+
+	MojObject report(MojObject::TypeObject);
+	err = report.putString("bootId", bootId.c_str()); MojErrCheck(err);
+	err = report.put("owners", owners); MojErrCheck(err);
+
+	MojString json;
+	err = report.toJson(json);
+	MojErrCheck(err);
+
+	ofstream file(reportFile.c_str(), ios::out | ios::trunc);
+	file << json.data();
+	if (!file.good()) {
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 1,
+				PMLOGKS("file", reportFile.c_str()),
+				"Failed to save owner costs to %s", reportFile.c_str());
+		MojErrThrow(MojErrInternal);
+	}
+	return MojErrNone;
+}
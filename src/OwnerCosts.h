@@ -0,0 +1,80 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef OWNERCOSTS_H_
+#define OWNERCOSTS_H_
+
+#include "core/MojObject.h"
+#include <glib.h>
+#include <map>
+#include <string>
+
+/**
+ * What each owner (app, service or system component) costs a run - bytes of
+ * configuration read, time spent parsing it, requests sent on its behalf &
+ * the cumulative time services took to answer them.
+ *
+ * The heaviest owners are reported by the "owners" method & saved when the
+ * process exits, merged with the report of earlier runs in the same boot.
+ */
+class OwnerCosts
+{
+public:
+	enum SortKey {
+		ByLatency,
+		ByBytes,
+		ByParseTime,
+		ByRequests,
+	};
+
+	void Read(const std::string& owner, size_t bytes);
+	void Parsed(const std::string& owner, gint64 parseUs);
+	void Requested(const std::string& owner);
+	void Replied(const std::string& owner, gint64 latencyUs);
+
+	bool Empty() const { return m_costs.empty(); }
+
+	static bool ParseSortKey(const std::string& name, SortKey& key);
+
+	// the n heaviest owners as [{"owner": ..., "bytesRead": ..., ...}]
+	MojErr Top(unsigned int n, SortKey key, MojObject& owners) const;
+
+	MojErr Save(const std::string& reportFile) const;
+	static MojErr Load(const std::string& reportFile, MojObject& report);
+
+private:
+	struct Cost {
+		MojInt64 bytesRead;
+		MojInt64 parseUs;
+		MojInt64 requests;
+		MojInt64 latencyUs;
+
+		Cost() : bytesRead(0), parseUs(0), requests(0), latencyUs(0) {}
+	};
+
+	typedef std::map<std::string, Cost> CostMap;
+
+	static const unsigned int REPORT_SIZE;
+
+	static MojErr Top(const CostMap& costs, unsigned int n, SortKey key, MojObject& owners);
+	static std::string BootId();
+
+	CostMap m_costs;
+};
+
+#endif /* OWNERCOSTS_H_ */
@@ -0,0 +1,203 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "OwnerReadiness.h"
+#include "Configurator.h"
+#include "Log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const OWNER_STAMP_DIR = "owners/";
+
+OwnerReadiness::OwnerReadiness()
+{
+}
+
+void OwnerReadiness::Expect(const std::string& owner)
+{
+	if (owner.empty())
+		return;
+
+	State& state = m_owners[owner];
+	state.expected++;
+	m_changed.push_back(owner);
+}
+
+void OwnerReadiness::Succeeded(const std::string& owner)
+{
+	if (owner.empty())
+		return;
+
+	StateMap::iterator i = m_owners.find(owner);
+	if (i == m_owners.end())
+		return;
+	i->second.succeeded++;
+	m_changed.push_back(owner);
+}
+
+void OwnerReadiness::Failed(const std::string& owner)
+{
+	if (owner.empty())
+		return;
+
+	m_owners[owner].failed = true;
+
+	// whatever an earlier run stamped doesn't hold any more
+	m_configured.erase(owner);
+	unlink(StampPath(owner).c_str());
+}
+
+void OwnerReadiness::Held(const std::string& owner)
+{
+	if (owner.empty())
+		return;
+
+	m_owners[owner].held++;
+	m_configured.erase(owner);
+}
+
+void OwnerReadiness::KindDeferred(const std::string& owner)
+{
+	if (owner.empty())
+		return;
+
+	m_deferredKinds[owner]++;
+	m_owners[owner];
+	m_configured.erase(owner);
+}
+
+void OwnerReadiness::DeferredKindDone(const std::string& owner, bool success)
+{
+	CountMap::iterator i = m_deferredKinds.find(owner);
+	if (i == m_deferredKinds.end())
+		return;
+	if (--i->second == 0)
+		m_deferredKinds.erase(i);
+
+	if (!success)
+		Failed(owner);
+	m_changed.push_back(owner);
+}
+
+void OwnerReadiness::TakeReady(std::vector<std::string>& ready)
+{
+	std::vector<std::string> changed;
+	changed.swap(m_changed);
+
+	for (std::vector<std::string>::const_iterator i = changed.begin(); i != changed.end(); ++i) {
+		StateMap::iterator state = m_owners.find(*i);
+		if (state == m_owners.end() || !state->second.Complete() ||
+				m_deferredKinds.find(*i) != m_deferredKinds.end())
+			continue;
+
+		// done - later configs of the owner (a new scan) start a new count
+		m_owners.erase(state);
+		Stamp(*i);
+		Notify(*i);
+		ready.push_back(*i);
+	}
+}
+
+bool OwnerReadiness::IsConfigured(const std::string& owner)
+{
+	if (m_configured.find(owner) != m_configured.end())
+		return true;
+
+	// in progress in this run - an old stamp doesn't count yet
+	if (m_owners.find(owner) != m_owners.end() || m_deferredKinds.find(owner) != m_deferredKinds.end())
+		return false;
+
+	if (access(StampPath(owner).c_str(), F_OK) != 0)
+		return false;
+
+	m_configured.insert(owner);
+	return true;
+}
+
+void OwnerReadiness::Forget(const std::string& owner)
+{
+	m_configured.erase(owner);
+	m_owners.erase(owner);
+	m_deferredKinds.erase(owner);
+	unlink(StampPath(owner).c_str());
+}
+
+void OwnerReadiness::Watch(const std::string& owner, MojServiceMessage* msg)
+{
+	m_waiters.insert(WaiterMap::value_type(owner, MojRefCountedPtr<MojServiceMessage>(msg)));
+}
+
+void OwnerReadiness::Reset()
+{
+	// only owners that are complete but for deferred kind updates carry
+	// over - anything else starts from nothing in the next run
+	for (StateMap::iterator i = m_owners.begin(); i != m_owners.end(); ) {
+		if (i->second.Complete() && m_deferredKinds.find(i->first) != m_deferredKinds.end()) {
+			i->second = State();
+			++i;
+		} else {
+			i = m_owners.erase(i);
+		}
+	}
+}
+
+std::string OwnerReadiness::StampPath(const std::string& owner) const
+{
+	return Configurator::ConfCacheDir() + OWNER_STAMP_DIR + owner;
+}
+
+void OwnerReadiness::Stamp(const std::string& owner)
+{
+	m_configured.insert(owner);
+
+	std::string stamp = StampPath(owner);
+	int fd = open(stamp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0 && errno == ENOENT) {
+		mkdir((Configurator::ConfCacheDir() + OWNER_STAMP_DIR).c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+		fd = open(stamp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	}
+
+	if (fd < 0) {
+		LOG_WARNING(MSGID_CONFIGURATOR_WARNING, 2,
+				PMLOGKS("owner", owner.c_str()),
+				PMLOGKS("error", strerror(errno)),
+				"failed to stamp %s as configured (%s)", owner.c_str(), strerror(errno));
+		return;
+	}
+	close(fd);
+}
+
+void OwnerReadiness::Notify(const std::string& owner)
+{
+	std::pair<WaiterMap::iterator, WaiterMap::iterator> waiters = m_waiters.equal_range(owner);
+	for (WaiterMap::iterator i = waiters.first; i != waiters.second; ++i) {
+		MojObject response(MojObject::TypeObject);
+		response.putString("id", owner.c_str());
+		response.putBool("configured", true);
+		if (i->second->replySuccess(response) != MojErrNone) {
+			LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 1,
+					PMLOGKS("owner", owner.c_str()),
+					"Failed to tell a waiter that %s is configured", owner.c_str());
+		}
+	}
+	m_waiters.erase(waiters.first, waiters.second);
+}
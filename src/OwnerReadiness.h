@@ -0,0 +1,97 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef OWNERREADINESS_H_
+#define OWNERREADINESS_H_
+
+#include "core/MojServiceMessage.h"
+#include <map>
+#include <string>
+#include <tr1/unordered_map>
+#include <tr1/unordered_set>
+#include <vector>
+
+/**
+ * Tracks, per owner (the ParentId of a config - an app or service id),
+ * whether all of its configs of the run have gone through.  An owner becomes
+ * configured once every kind, permission, file cache type & activity found
+ * for it has succeeded and nothing can add to it any more; it is then
+ * stamped in the cache directory so that isConfigured is a hash lookup or a
+ * single access() - and callers waiting on it are told.
+ */
+class OwnerReadiness
+{
+public:
+	OwnerReadiness();
+
+	// a config of the owner was found (or a deferred update for it queued)
+	void Expect(const std::string& owner);
+	void Succeeded(const std::string& owner);
+	void Failed(const std::string& owner);
+	// a config of the owner waits for a later run (breaker, first use) - the
+	// owner isn't configured in this one
+	void Held(const std::string& owner);
+	// a kind update of the owner is held back until after the sweep - the
+	// owner isn't configured until it has been applied, even across runs
+	void KindDeferred(const std::string& owner);
+	void DeferredKindDone(const std::string& owner, bool success);
+
+	// stamps & answers the waiters of every owner that has become configured
+	// since the last call - only valid once all configurators have scanned
+	void TakeReady(std::vector<std::string>& ready);
+
+	bool IsConfigured(const std::string& owner);
+	// the owner is being unconfigured - drops its stamp
+	void Forget(const std::string& owner);
+	// replies {"configured": true} once the owner is configured
+	void Watch(const std::string& owner, MojServiceMessage* msg);
+	// the run is over - failed & held owners get another chance in the next
+	// one; owners complete but for deferred kind updates carry over
+	void Reset();
+
+private:
+	struct State {
+		unsigned int expected;
+		unsigned int succeeded;
+		unsigned int held;
+		bool failed;
+
+		State() : expected(0), succeeded(0), held(0), failed(false) {}
+
+		bool Complete() const { return !failed && held == 0 && succeeded >= expected; }
+	};
+
+	typedef std::tr1::unordered_map<std::string, State> StateMap;
+	typedef std::multimap<std::string, MojRefCountedPtr<MojServiceMessage> > WaiterMap;
+	typedef std::map<std::string, unsigned int> CountMap;
+
+	std::string StampPath(const std::string& owner) const;
+	void        Stamp(const std::string& owner);
+	void        Notify(const std::string& owner);
+
+	StateMap m_owners;
+	// owners whose counts moved since the last TakeReady
+	std::vector<std::string> m_changed;
+	std::tr1::unordered_set<std::string> m_configured;
+	// deferred kind updates not yet applied, per owner - kept apart from the
+	// per-run counts, which Reset drops
+	CountMap m_deferredKinds;
+	WaiterMap m_waiters;
+};
+
+#endif /* OWNERREADINESS_H_ */
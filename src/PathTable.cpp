@@ -0,0 +1,168 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "PathTable.h"
+
+std::vector<const std::string*> PathTable::s_names;
+PathTable::StringIds PathTable::s_nameIds;
+std::vector<const std::string*> PathTable::s_dirs;
+std::vector<PathTable::NameId> PathTable::s_dirNames;
+PathTable::StringIds PathTable::s_dirIds;
+std::vector<PathTable::Entry> PathTable::s_entries;
+PathTable::EntryIds PathTable::s_entryIds;
+unsigned int PathTable::s_lookups = 0;
+
+PathTable::PathId PathTable::Intern(const std::string& directory, const std::string& name)
+{
+	DirId dir = InternDirectory(directory);
+	NameId nameId = InternName(name);
+
+	guint64 key = Key(dir, nameId);
+	EntryIds::const_iterator i = s_entryIds.find(key);
+	if (i != s_entryIds.end())
+		return i->second;
+
+	Entry entry;
+	entry.dir = dir;
+	entry.name = nameId;
+	PathId id = s_entries.size();
+	s_entries.push_back(entry);
+	s_entryIds[key] = id;
+	return id;
+}
+
+PathTable::PathId PathTable::Intern(const std::string& filePath)
+{
+	size_t slash = filePath.rfind('/');
+	if (slash == std::string::npos)
+		return Intern("", filePath);
+	return Intern(filePath.substr(0, slash), filePath.substr(slash + 1));
+}
+
+PathTable::PathId PathTable::Find(const std::string& filePath)
+{
+	s_lookups++;
+
+	size_t slash = filePath.rfind('/');
+	std::string directory = slash == std::string::npos ? "" : filePath.substr(0, slash);
+
+	StringIds::const_iterator dir = s_dirIds.find(directory);
+	if (dir == s_dirIds.end())
+		return InvalidPath;
+	StringIds::const_iterator name = s_nameIds.find(filePath.substr(slash + 1));
+	if (name == s_nameIds.end())
+		return InvalidPath;
+	EntryIds::const_iterator i = s_entryIds.find(Key(dir->second, name->second));
+	if (i == s_entryIds.end())
+		return InvalidPath;
+	return i->second;
+}
+
+std::string PathTable::Path(PathId id)
+{
+	const Entry& entry = s_entries[id];
+	const std::string& directory = *s_dirs[entry.dir];
+	const std::string& name = *s_names[entry.name];
+
+	std::string path;
+	path.reserve(directory.size() + 1 + name.size());
+	path.append(directory);
+	if (!directory.empty())
+		path.append("/");
+	path.append(name);
+	return path;
+}
+
+const std::string& PathTable::Directory(PathId id)
+{
+	return *s_dirs[s_entries[id].dir];
+}
+
+const std::string& PathTable::Name(PathId id)
+{
+	return *s_names[s_entries[id].name];
+}
+
+const std::string& PathTable::DirectoryName(PathId id)
+{
+	return *s_names[DirectoryNameId(id)];
+}
+
+PathTable::NameId PathTable::DirectoryNameId(PathId id)
+{
+	return s_dirNames[s_entries[id].dir];
+}
+
+const std::string& PathTable::NameOf(NameId id)
+{
+	return *s_names[id];
+}
+
+size_t PathTable::Size()
+{
+	return s_entries.size();
+}
+
+MojErr PathTable::ToJson(MojObject& stats)
+{
+	MojErr err;
+
+	size_t bytes = 0;
+	for (StringIds::const_iterator i = s_dirIds.begin(); i != s_dirIds.end(); ++i)
+		bytes += i->first.size();
+	for (StringIds::const_iterator i = s_nameIds.begin(); i != s_nameIds.end(); ++i)
+		bytes += i->first.size();
+
+	err = stats.putInt("paths", s_entries.size()); MojErrCheck(err);
+	err = stats.putInt("directories", s_dirs.size()); MojErrCheck(err);
+	err = stats.putInt("names", s_names.size()); MojErrCheck(err);
+	err = stats.putInt("stringBytes", bytes); MojErrCheck(err);
+	err = stats.putInt("lookups", s_lookups); MojErrCheck(err);
+	return MojErrNone;
+}
+
+PathTable::DirId PathTable::InternDirectory(const std::string& directory)
+{
+	StringIds::const_iterator i = s_dirIds.find(directory);
+	if (i != s_dirIds.end())
+		return i->second;
+
+	DirId id = s_dirs.size();
+	NameId name = InternName(directory.substr(directory.rfind('/') + 1));
+	i = s_dirIds.insert(StringIds::value_type(directory, id)).first;
+	s_dirs.push_back(&i->first);
+	s_dirNames.push_back(name);
+	return id;
+}
+
+PathTable::NameId PathTable::InternName(const std::string& name)
+{
+	StringIds::const_iterator i = s_nameIds.find(name);
+	if (i != s_nameIds.end())
+		return i->second;
+
+	NameId id = s_names.size();
+	i = s_nameIds.insert(StringIds::value_type(name, id)).first;
+	s_names.push_back(&i->first);
+	return id;
+}
+
+guint64 PathTable::Key(DirId dir, NameId name)
+{
+	return (static_cast<guint64>(dir) << 32) | name;
+}
@@ -0,0 +1,91 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef PATHTABLE_H_
+#define PATHTABLE_H_
+
+#include "core/MojObject.h"
+#include <glib.h>
+#include <string>
+#include <tr1/unordered_map>
+#include <vector>
+
+/**
+ * Process-wide store of the config file paths seen by all configurators.
+ * Every directory is kept once (as a full path) & every file name once; a
+ * config file is a (directory id, name id) pair & callers hold it by handle.
+ * Resolving a handle is an index into a vector, so the scan lists, pending
+ * lists & results only carry 32 bit ids instead of thousands of copies of
+ * the same prefixes.
+ *
+ * The name of a file's directory is interned as well - that is the parent
+ * (app or service) id the config is charged to.
+ */
+class PathTable
+{
+public:
+	typedef guint32 PathId;
+	typedef guint32 NameId;
+
+	static const PathId InvalidPath = 0xffffffff;
+
+	// returns the handle for directory/name, adding it if necessary
+	static PathId Intern(const std::string& directory, const std::string& name);
+	static PathId Intern(const std::string& filePath);
+
+	// looks up an already interned path without adding it
+	static PathId Find(const std::string& filePath);
+
+	static std::string        Path(PathId id);
+	static const std::string& Directory(PathId id);
+	static const std::string& Name(PathId id);
+	// the last component of the directory the file is in
+	static const std::string& DirectoryName(PathId id);
+	static NameId             DirectoryNameId(PathId id);
+	static const std::string& NameOf(NameId id);
+
+	static size_t Size();
+	static MojErr ToJson(MojObject& stats);
+
+private:
+	typedef guint32 DirId;
+	typedef std::tr1::unordered_map<std::string, guint32> StringIds;
+	typedef std::tr1::unordered_map<guint64, PathId> EntryIds;
+
+	struct Entry {
+		DirId dir;
+		NameId name;
+	};
+
+	static DirId  InternDirectory(const std::string& directory);
+	static NameId InternName(const std::string& name);
+	static guint64 Key(DirId dir, NameId name);
+
+	// the strings live in the hash maps (their nodes don't move) - the
+	// vectors index them by id
+	static std::vector<const std::string*> s_names;
+	static StringIds s_nameIds;
+	static std::vector<const std::string*> s_dirs;
+	static std::vector<NameId> s_dirNames;
+	static StringIds s_dirIds;
+	static std::vector<Entry> s_entries;
+	static EntryIds s_entryIds;
+	static unsigned int s_lookups;
+};
+
+#endif /* PATHTABLE_H_ */
@@ -0,0 +1,134 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "ProgressReporter.h"
+#include "Log.h"
+
+ProgressReporter::ProgressReporter()
+: m_ledger(NULL),
+  m_sent(0)
+{
+}
+
+MojErr ProgressReporter::Start(MojServiceMessage* msg, const ResultLedger& ledger)
+{
+	LOG_TRACE("Entering function %s", __FUNCTION__);
+
+	m_msg.reset(msg);
+	m_ledger = &ledger;
+	// the ledger of the run starts out empty
+	m_sent = 0;
+
+	MojObject response(MojObject::TypeObject);
+	MojErr err = response.putBool("subscribed", true);
+	MojErrCheck(err);
+	err = Send(response);
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+void ProgressReporter::Stop()
+{
+	m_msg.reset();
+	m_sent = 0;
+}
+
+bool ProgressReporter::Active() const
+{
+	return m_msg.get() != NULL;
+}
+
+MojErr ProgressReporter::FlushFiles(bool force)
+{
+	if (!Active())
+		return MojErrNone;
+
+	const ResultLedger& ledger = *m_ledger;
+	size_t waiting = ledger.Size() - m_sent;
+	if (waiting == 0 || (!force && waiting < BATCH_SIZE))
+		return MojErrNone;
+
+	MojObject files(MojObject::TypeArray);
+	MojErr err = ledger.ToJson(files, m_sent);
+	MojErrCheck(err);
+	m_sent = ledger.Size();
+
+	MojObject update(MojObject::TypeObject);
+	err = update.putString("event", "files"); MojErrCheck(err);
+	err = update.put("files", files); MojErrCheck(err);
+	err = Send(update);
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+MojErr ProgressReporter::ConfiguratorDone(const char* configurator, const std::string& id)
+{
+	if (!Active())
+		return MojErrNone;
+
+	// the files of the configurator go out first
+	MojErr err = FlushFiles(true);
+	MojErrCheck(err);
+
+	MojObject update(MojObject::TypeObject);
+	err = update.putString("event", "configurator"); MojErrCheck(err);
+	err = update.putString("configurator", configurator); MojErrCheck(err);
+	err = update.putString("id", id.c_str()); MojErrCheck(err);
+	err = Send(update);
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+MojErr ProgressReporter::AppDone(const std::string& id)
+{
+	return SendEvent("app", id);
+}
+
+MojErr ProgressReporter::OwnerConfigured(const std::string& owner)
+{
+	return SendEvent("configured", owner);
+}
+
+MojErr ProgressReporter::SendEvent(const char* event, const std::string& id)
+{
+	if (!Active())
+		return MojErrNone;
+
+	MojObject update(MojObject::TypeObject);
+	MojErr err = update.putString("event", event); MojErrCheck(err);
+	err = update.putString("id", id.c_str()); MojErrCheck(err);
+	err = Send(update);
+	MojErrCheck(err);
+	return MojErrNone;
+}
+
+MojErr ProgressReporter::Send(MojObject& update)
+{
+	MojErr err = update.putBool("returnValue", true);
+	MojErrCheck(err);
+
+	err = m_msg->reply(update);
+	if (err) {
+		// the subscriber is gone - the run carries on without updates
+		LOG_WARNING(MSGID_BUS_CLIENT_ERROR, 1,
+				PMLOGKFV("error", "%d", err),
+				"Failed to send progress update (MojErr: %i) - unsubscribing", err);
+		m_msg.reset();
+	}
+	return MojErrNone;
+}
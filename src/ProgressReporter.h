@@ -0,0 +1,67 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef PROGRESSREPORTER_H_
+#define PROGRESSREPORTER_H_
+
+#include "core/MojServiceMessage.h"
+#include "ResultLedger.h"
+#include <string>
+
+/**
+ * Streams the progress of a run/scan/unconfigure to a caller that asked for
+ * it with "subscribe": true.  Besides the final reply the caller gets
+ *
+ *   {"event": "files", "files": [<ledger records>]}    in batches
+ *   {"event": "configurator", "configurator": ..., "id": ...}
+ *   {"event": "app", "id": ...}                         all of an id's configurators are done
+ *
+ * so that dependent work (launching an app whose kinds are in) can start
+ * before the whole run is over.
+ */
+class ProgressReporter
+{
+public:
+	ProgressReporter();
+
+	// replies {"subscribed": true} - updates from the ledger of the
+	// request's lane follow on msg until Stop()
+	MojErr Start(MojServiceMessage* msg, const ResultLedger& ledger);
+	void   Stop();
+	bool   Active() const;
+
+	// sends the ledger records added since the last batch - a partial batch
+	// only if force is set
+	MojErr FlushFiles(bool force);
+	MojErr ConfiguratorDone(const char* configurator, const std::string& id);
+	MojErr AppDone(const std::string& id);
+	MojErr OwnerConfigured(const std::string& owner);
+
+private:
+	static const size_t BATCH_SIZE = 32;
+
+	MojErr SendEvent(const char* event, const std::string& id);
+	MojErr Send(MojObject& update);
+
+	MojRefCountedPtr<MojServiceMessage> m_msg;
+	const ResultLedger* m_ledger;
+	// ledger records streamed so far
+	size_t m_sent;
+};
+
+#endif /* PROGRESSREPORTER_H_ */
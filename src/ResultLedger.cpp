@@ -0,0 +1,103 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "ResultLedger.h"
+
+#include <string.h>
+
+ResultLedger::ResultLedger()
+{
+	Clear();
+}
+
+void ResultLedger::Add(PathTable::PathId path, const char* type, Status status, MojErr err, gint64 latencyUs)
+{
+	Record record;
+	record.path = path;
+	record.type = TypeIndex(type);
+	record.status = status;
+	record.err = err;
+	record.latencyMs = latencyUs > 0 ? latencyUs / 1000 : 0;
+	m_records.push_back(record);
+	m_counts[status]++;
+}
+
+void ResultLedger::Clear()
+{
+	// a long-lived service shouldn't keep the capacity of its biggest run
+	std::vector<Record>().swap(m_records);
+	memset(m_counts, 0, sizeof(m_counts));
+}
+
+size_t ResultLedger::Count(Status status) const
+{
+	return m_counts[status];
+}
+
+size_t ResultLedger::Size() const
+{
+	return m_records.size();
+}
+
+MojErr ResultLedger::ToJson(MojObject& records, size_t first) const
+{
+	MojErr err;
+
+	if (first >= m_records.size())
+		return MojErrNone;
+
+	for (std::vector<Record>::const_iterator i = m_records.begin() + first; i != m_records.end(); ++i) {
+		MojObject record(MojObject::TypeObject);
+		err = record.putString("path", PathTable::Path(i->path).c_str()); MojErrCheck(err);
+		err = record.putString("type", m_types[i->type]); MojErrCheck(err);
+		err = record.putString("status", StatusName(static_cast<Status>(i->status))); MojErrCheck(err);
+		if (i->err != MojErrNone) {
+			err = record.putInt("errorCode", i->err); MojErrCheck(err);
+		}
+		if (i->latencyMs != 0) {
+			err = record.putInt("latencyMs", i->latencyMs); MojErrCheck(err);
+		}
+		err = records.push(record);
+		MojErrCheck(err);
+	}
+	return MojErrNone;
+}
+
+const char* ResultLedger::StatusName(Status status)
+{
+	switch (status) {
+	case Ok:
+		return "ok";
+	case Failed:
+		return "failed";
+	case Deferred:
+		return "deferred";
+	default:
+		return "unknown";
+	}
+}
+
+guint8 ResultLedger::TypeIndex(const char* type)
+{
+	for (size_t i = 0; i < m_types.size(); i++) {
+		if (m_types[i] == type)
+			return i;
+	}
+	m_types.push_back(type);
+	return m_types.size() - 1;
+}
@@ -0,0 +1,75 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef RESULTLEDGER_H_
+#define RESULTLEDGER_H_
+
+#include "core/MojObject.h"
+#include "PathTable.h"
+#include <glib.h>
+#include <vector>
+
+/**
+ * Outcome of every config file handled in a run - one fixed size record per
+ * file (path handle, configurator type, status, error, latency), so the
+ * ledger grows with the number of files and never with their content.
+ * Callers of run/scan/unconfigure can ask for it in the reply.
+ */
+class ResultLedger
+{
+public:
+	enum Status {
+		Ok,
+		Failed,
+		Deferred,
+		StatusCount,
+	};
+
+	ResultLedger();
+
+	// type is a configurator name - ConfiguratorName() returns literals, so
+	// they are told apart by address
+	void   Add(PathTable::PathId path, const char* type, Status status, MojErr err = MojErrNone, gint64 latencyUs = 0);
+	void   Clear();
+
+	size_t Count(Status status) const;
+	size_t Size() const;
+
+	// [{"path": ..., "type": ..., "status": ..., "errorCode": ..., "latencyMs": ...}]
+	// for the records from first on
+	MojErr ToJson(MojObject& records, size_t first = 0) const;
+
+	static const char* StatusName(Status status);
+
+private:
+	struct Record {
+		PathTable::PathId path;
+		guint8 type;
+		guint8 status;
+		gint32 err;
+		guint32 latencyMs;
+	};
+
+	guint8 TypeIndex(const char* type);
+
+	std::vector<Record> m_records;
+	std::vector<const char*> m_types;
+	size_t m_counts[StatusCount];
+};
+
+#endif /* RESULTLEDGER_H_ */
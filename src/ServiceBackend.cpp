@@ -0,0 +1,59 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "ServiceBackend.h"
+#include "luna/MojLunaService.h"
+
+ReplyHandler::ReplyHandler()
+	: m_slot(this, &ReplyHandler::HandleReply),
+	  m_generation(0)
+{
+}
+
+ReplyHandler::~ReplyHandler()
+{
+}
+
+void ReplyHandler::Cancel()
+{
+	m_slot.cancel();
+	m_generation++;
+}
+
+LunaServiceBackend::LunaServiceBackend(MojLunaService& service)
+	: m_service(service)
+{
+}
+
+LunaServiceBackend::~LunaServiceBackend()
+{
+}
+
+MojErr LunaServiceBackend::Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies)
+{
+	MojRefCountedPtr<MojServiceRequest> request;
+	MojErr err;
+
+	if (forgedAppId && *forgedAppId)
+		err = m_service.createRequest(request, false, forgedAppId);
+	else
+		err = m_service.createRequest(request);
+	MojErrCheck(err);
+
+	return request->send(handler->m_slot, service, method, payload, numReplies);
+}
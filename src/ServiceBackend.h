@@ -0,0 +1,77 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef SERVICEBACKEND_H_
+#define SERVICEBACKEND_H_
+
+#include "core/MojServiceRequest.h"
+#include "core/MojSignal.h"
+
+class MojLunaService;
+
+/**
+ * Receives the replies to requests sent through a ServiceBackend.
+ */
+class ReplyHandler : public MojSignalHandler
+{
+public:
+	typedef MojServiceRequest::ReplySignal::Slot<ReplyHandler> ReplySlot;
+
+	ReplyHandler();
+	virtual ~ReplyHandler();
+
+	// stop delivery of replies to everything sent so far
+	void Cancel();
+	unsigned int Generation() const { return m_generation; }
+
+	ReplySlot m_slot;
+
+protected:
+	virtual MojErr HandleReply(MojObject& response, MojErr err) = 0;
+
+private:
+	unsigned int m_generation;
+
+	friend class MockServiceBackend;
+};
+
+/**
+ * Where configurator requests go - luna-service on a device, or a local
+ * stand-in (see MockServiceBackend) when there is no bus.
+ */
+class ServiceBackend
+{
+public:
+	virtual ~ServiceBackend() {}
+
+	virtual MojErr Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies) = 0;
+};
+
+class LunaServiceBackend : public ServiceBackend
+{
+public:
+	LunaServiceBackend(MojLunaService& service);
+	virtual ~LunaServiceBackend();
+
+	virtual MojErr Send(ReplyHandler* handler, const char* service, const char* method, const MojObject& payload, const char* forgedAppId, MojUInt32 numReplies);
+
+private:
+	MojLunaService& m_service;
+};
+
+#endif /* SERVICEBACKEND_H_ */
@@ -0,0 +1,153 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#include "Tracer.h"
+#include "Log.h"
+
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+
+Tracer::Tracer()
+	: m_started(0),
+	  m_nextId(0)
+{
+}
+
+Tracer::~Tracer()
+{
+	if (Enabled())
+		Write();
+}
+
+void Tracer::Enable(const std::string& traceFile)
+{
+	m_traceFile = traceFile;
+	m_started = g_get_monotonic_time();
+}
+
+gint64 Tracer::Now() const
+{
+	return g_get_monotonic_time() - m_started;
+}
+
+void Tracer::Complete(const char* name, const char* category, gint64 start, const std::string& detail)
+{
+	if (!Enabled())
+		return;
+
+	Event event = { 'X', name, category, detail, start, Now() - start, 0, true };
+	m_events.push_back(event);
+}
+
+void Tracer::Instant(const char* name, const char* category)
+{
+	if (!Enabled())
+		return;
+
+	Event event = { 'i', name, category, std::string(), Now(), 0, 0, true };
+	m_events.push_back(event);
+}
+
+unsigned int Tracer::BeginAsync(const char* name, const char* category, const std::string& detail)
+{
+	if (!Enabled())
+		return 0;
+
+	Event event = { 'b', name, category, detail, Now(), 0, ++m_nextId, true };
+	m_events.push_back(event);
+	return event.id;
+}
+
+void Tracer::EndAsync(const char* name, const char* category, unsigned int id, bool success)
+{
+	if (!Enabled() || id == 0)
+		return;
+
+	Event event = { 'e', name, category, std::string(), Now(), 0, id, success };
+	m_events.push_back(event);
+}
+
+MojErr Tracer::Write() const
+{
+	MojObject events(MojObject::TypeArray);
+	MojErr err;
+	int pid = getpid();
+
+	for (vector<Event>::const_iterator i = m_events.begin(); i != m_events.end(); ++i) {
+		MojObject event(MojObject::TypeObject);
+		MojObject args(MojObject::TypeObject);
+		char phase[2] = { i->phase, '\0' };
+
+		err = event.putString("name", i->name); MojErrCheck(err);
+		err = event.putString("cat", i->category); MojErrCheck(err);
+		err = event.putString("ph", phase); MojErrCheck(err);
+		err = event.putInt("ts", i->ts); MojErrCheck(err);
+		err = event.putInt("pid", pid); MojErrCheck(err);
+		err = event.putInt("tid", pid); MojErrCheck(err);
+
+		switch (i->phase) {
+		case 'X':
+			err = event.putInt("dur", i->dur); MojErrCheck(err);
+			break;
+		case 'i':
+			err = event.putString("s", "p"); MojErrCheck(err);
+			break;
+		case 'b':
+		case 'e':
+			err = event.putInt("id", i->id); MojErrCheck(err);
+			err = args.putInt("traceId", i->id); MojErrCheck(err);
+			if (i->phase == 'e') {
+				err = args.putBool("success", i->success);
+				MojErrCheck(err);
+			}
+			break;
+		}
+
+		if (!i->detail.empty()) {
+			err = args.putString("config", i->detail.c_str());
+			MojErrCheck(err);
+		}
+		err = event.put("args", args); MojErrCheck(err);
+		err = events.push(event); MojErrCheck(err);
+	}
+
+	MojObject trace(MojObject::TypeObject);
+	err = trace.put("traceEvents", events); MojErrCheck(err);
+	err = trace.putString("displayTimeUnit", "ms"); MojErrCheck(err);
+
+	MojString json;
+	err = trace.toJson(json);
+	MojErrCheck(err);
+
+	ofstream file(m_traceFile.c_str(), ios::out | ios::trunc);
+	file << json.data();
+	if (!file.good()) {
+		LOG_WARNING(MSGID_TRACE, 1,
+				PMLOGKS("file", m_traceFile.c_str()),
+				"Failed to write trace to %s", m_traceFile.c_str());
+		MojErrThrow(MojErrInternal);
+	}
+
+	LOG_INFO(MSGID_TRACE, 2,
+			PMLOGKS("file", m_traceFile.c_str()),
+			PMLOGKFV("events", "%zu", m_events.size()),
+			"Wrote %zu trace events to %s", m_events.size(), m_traceFile.c_str());
+	return MojErrNone;
+}
@@ -0,0 +1,102 @@
+// @@@LICENSE
+//
+//      Copyright (c) 2009-2013 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LICENSE@@@
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include "core/MojObject.h"
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/**
+ * Records spans of a configurator run & writes them out as a Chrome
+ * trace-event file (chrome://tracing, ui.perfetto.dev) when the run ends.
+ * Off unless a file is given - every call returns straight away then.
+ */
+class Tracer
+{
+public:
+	Tracer();
+	~Tracer();
+
+	void Enable(const std::string& traceFile);
+	bool Enabled() const { return !m_traceFile.empty(); }
+
+	// µs since tracing was enabled
+	gint64 Now() const;
+
+	// a span on the main loop that started at start & ends now
+	void Complete(const char* name, const char* category, gint64 start, const std::string& detail);
+	void Instant(const char* name, const char* category);
+
+	// a request in flight - returns the trace id to log with the request
+	unsigned int BeginAsync(const char* name, const char* category, const std::string& detail);
+	void EndAsync(const char* name, const char* category, unsigned int id, bool success);
+
+	MojErr Write() const;
+
+private:
+	struct Event {
+		char phase;
+		const char* name;
+		const char* category;
+		std::string detail;
+		gint64 ts;
+		gint64 dur;
+		unsigned int id;
+		bool success;
+	};
+
+	std::string m_traceFile;
+	gint64 m_started;
+	unsigned int m_nextId;
+	std::vector<Event> m_events;
+};
+
+/**
+ * Traces the enclosing scope as a span.
+ */
+class TraceSpan
+{
+public:
+	TraceSpan(Tracer& tracer, const char* name, const char* category, const std::string& detail = std::string())
+		: m_tracer(tracer),
+		  m_name(name),
+		  m_category(category),
+		  m_start(tracer.Enabled() ? tracer.Now() : 0)
+	{
+		if (tracer.Enabled())
+			m_detail = detail;
+	}
+
+	~TraceSpan()
+	{
+		if (m_tracer.Enabled())
+			m_tracer.Complete(m_name, m_category, m_start, m_detail);
+	}
+
+private:
+	Tracer& m_tracer;
+	const char* m_name;
+	const char* m_category;
+	std::string m_detail;
+	gint64 m_start;
+};
+
+#endif /* TRACER_H_ */